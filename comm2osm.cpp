@@ -5,6 +5,7 @@
  */
 
 #include <getopt.h>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <gdal/ogrsf_frmts.h>
@@ -14,6 +15,7 @@
 #include "plugins/dummy/dummy_plugin.hpp"
 
 boost::filesystem::path input_path, output_file;
+plugin_options options;
 
 void print_help() {
     std::cout << "comm2osm [OPTIONS] [INFILE [OUTFILE]]\n\n"
@@ -27,15 +29,31 @@ void print_help() {
 			<< "  bz2        compressed with bzip2\n"
 			<< "\nOptions:\n"
 			<< "  -h, --help                This help message\n"
-			<< "  -t, --to-format=FORMAT    Output format\n";
+			<< "  -t, --to-format=FORMAT    Output format\n"
+			<< "  -j, --threads=N           Number of threads for processing streets and\n"
+			<< "                            administrative boundaries (default: 1)\n"
+			<< "  -p, --processes=N         Convert up to N input directories at the same time in separate\n"
+			<< "                            processes and connect them at their borders (default: 1).\n"
+			<< "                            Turn restrictions across directories are lost.\n"
+			<< "  -s, --stream              Write output while converting (lower memory usage)\n"
+			<< "  -i, --index=TYPE          Node location index: memory (default) or mmap (file backed)\n"
+			<< "      --index-dir=DIR       Directory for mmap index files and results of processes\n"
+			<< "                            (default: $TMPDIR or /tmp)\n"
+			<< "      --stats[=json]        Print time, throughput and memory usage per phase to stderr\n"
+			<< "      --stream-z-levels     Read z-levels along with streets if both are ordered by LINK_ID\n"
+			<< "      --admin-topology      Build borders shared by administrative areas only once\n";
 }
 
 void check_args_and_setup(int argc, char* argv[]) {
     // options
-    static struct option long_options[] = { { "help", no_argument, 0, 'h' }, { 0, 0 } };
+    static struct option long_options[] = { { "help", no_argument, 0, 'h' }, { "threads", required_argument, 0, 'j' },
+            { "processes", required_argument, 0, 'p' }, { "stream", no_argument, 0, 's' },
+            { "index", required_argument, 0, 'i' }, { "index-dir", required_argument, 0, 'D' },
+            { "stats", optional_argument, 0, 'S' }, { "stream-z-levels", no_argument, 0, 'Z' },
+            { "admin-topology", no_argument, 0, 'A' }, { 0, 0 } };
 
     while (true) {
-        int c = getopt_long(argc, argv, "dhf:t:", long_options, 0);
+        int c = getopt_long(argc, argv, "dhsf:t:j:p:i:", long_options, 0);
         if (c == -1) {
             break;
         }
@@ -44,6 +62,58 @@ void check_args_and_setup(int argc, char* argv[]) {
             case 'h':
                 print_help();
                 exit(0);
+            case 'j': {
+                char* end;
+                long threads = strtol(optarg, &end, 10);
+                if (*end || threads < 1) {
+                    std::cerr << "invalid number of threads: " << optarg << std::endl;
+                    exit(1);
+                }
+                options.threads = threads;
+                break;
+            }
+            case 'p': {
+                char* end;
+                long processes = strtol(optarg, &end, 10);
+                if (*end || processes < 1) {
+                    std::cerr << "invalid number of processes: " << optarg << std::endl;
+                    exit(1);
+                }
+                options.processes = processes;
+                break;
+            }
+            case 's':
+                options.stream_output = true;
+                break;
+            case 'i':
+                if (!strcmp(optarg, "memory")) {
+                    options.index_backend = location_index_backend::memory;
+                } else if (!strcmp(optarg, "mmap")) {
+                    options.index_backend = location_index_backend::mmap;
+                } else {
+                    std::cerr << "invalid index type: " << optarg << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'D':
+                options.index_dir = boost::filesystem::path(optarg);
+                break;
+            case 'S':
+                if (!optarg || !strcmp(optarg, "text")) {
+                    options.stats = stats_format::text;
+                } else if (!strcmp(optarg, "json")) {
+                    options.stats = stats_format::json;
+                } else {
+                    std::cerr << "invalid stats format: " << optarg << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'Z':
+                options.stream_z_levels = true;
+                break;
+            case 'A':
+                options.admin_topology = true;
+                break;
             default:
                 exit(1);
         }
@@ -73,6 +143,7 @@ int main(int argc, char* argv[]) {
     plugins.push_back(new navteq_plugin(executable_path));
 
     for (auto plugin : plugins) {
+        plugin->set_options(options);
         if (plugin->check_input(input_path, output_file)) {
             std::cout << "executing plugin " << plugin->get_name() << std::endl;
             plugin->execute();
@@ -14,12 +14,38 @@
 
 #include <osmium/io/error.hpp>
 
+#include "location_index.hpp"
+#include "stats.hpp"
+
+/*
+ * \brief  Options given on the command line which apply to all plugins.
+ * */
+struct plugin_options {
+    // number of threads a plugin may use for processing
+    unsigned int threads = 1;
+    // write objects to the output file while converting instead of keeping them until the end
+    bool stream_output = false;
+    // storage of node location indices
+    location_index_backend index_backend = location_index_backend::memory;
+    // directory of index files (default: temporary directory)
+    boost::filesystem::path index_dir;
+    // report of timing, throughput and memory usage per phase
+    stats_format stats = stats_format::none;
+    // read z-levels along with the streets instead of indexing them first (needs input ordered by link id)
+    bool stream_z_levels = false;
+    // number of input directories converted at the same time in separate processes (1: all in one process)
+    unsigned int processes = 1;
+    // build borders shared by administrative areas once instead of once per area
+    bool admin_topology = false;
+};
+
 class base_plugin {
 public:
     const char* name;
     boost::filesystem::path input_path;
     boost::filesystem::path output_path;
     boost::filesystem::path executable_path;
+    plugin_options options;
 
     base_plugin(){
         this->name = "";
@@ -41,6 +67,10 @@ public:
     }
     ;
 
+    void set_options(const plugin_options& options_rhs) {
+        options = options_rhs;
+    }
+
     /*
      * \brief	Sets input_path and output_path.
      *
@@ -0,0 +1,196 @@
+/*
+ * bounded_queue.hpp
+ *
+ * Lock-free queue of fixed capacity to connect the stages of a pipeline and a monitor to wait for it.
+ */
+
+#ifndef PLUGINS_BOUNDED_QUEUE_HPP_
+#define PLUGINS_BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/**
+ * \brief Bounded multi-producer multi-consumer queue (Dmitry Vyukov's array based queue).
+ *
+ *        Every cell carries a sequence number which tells producers and consumers whether the
+ *        cell is free or filled for their position, so push and pop need a single compare and
+ *        swap and never block each other. try_push() fails if the queue is full, try_pop() if it
+ *        is empty; waiting is left to the caller. The capacity is rounded up to a power of two.
+ */
+template <class T>
+class bounded_queue {
+    struct cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    // keeps the positions of producers and consumers in different cache lines
+    static constexpr size_t cache_line_size = 64;
+
+    std::unique_ptr<cell[]> cells;
+    size_t mask;
+    char pad0[cache_line_size];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[cache_line_size];
+    std::atomic<size_t> dequeue_pos;
+    char pad2[cache_line_size];
+
+    static size_t capacity_for(size_t size) {
+        size_t capacity = 2;
+        while (capacity < size)
+            capacity <<= 1;
+        return capacity;
+    }
+
+public:
+    explicit bounded_queue(size_t capacity) :
+            cells(new cell[capacity_for(capacity)]), mask(capacity_for(capacity) - 1), enqueue_pos(0), dequeue_pos(
+                    0) {
+        for (size_t i = 0; i <= mask; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    /**
+     * \brief moves value into the queue.
+     * \return false if the queue is full, value is left unchanged then.
+     */
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell& c = cells[pos & mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.data = std::move(value);
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * \brief moves the oldest element into value.
+     * \return false if the queue is empty.
+     */
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell& c = cells[pos & mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(c.data);
+                    c.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/**
+ * \brief Lets the stages of a pipeline sleep until a condition on the shared state holds, e.g. until
+ *        a bounded_queue has room or an element.
+ *
+ *        The state itself is changed without the monitor (lock-free queues, atomic counters), every
+ *        change a waiting stage may depend on has to be followed by notify(). notify() takes the
+ *        mutex once, so a stage can't miss a change between checking its condition and sleeping.
+ */
+class pipeline_monitor {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::atomic<bool> aborted_flag;
+
+public:
+    pipeline_monitor() :
+            aborted_flag(false) {
+    }
+
+    pipeline_monitor(const pipeline_monitor&) = delete;
+    pipeline_monitor& operator=(const pipeline_monitor&) = delete;
+
+    bool aborted() const {
+        return aborted_flag;
+    }
+
+    /**
+     * \brief stops the pipeline, all waiting and future calls of wait() return false.
+     */
+    void abort() {
+        aborted_flag = true;
+        notify();
+    }
+
+    /**
+     * \brief wakes the stages waiting for a change.
+     */
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        changed.notify_all();
+    }
+
+    /**
+     * \brief waits until condition() returns true. condition may change the state, e.g. pop an element.
+     * \return false if the pipeline has been aborted before.
+     */
+    template <class TCondition>
+    bool wait(TCondition condition) {
+        if (condition()) return true;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (aborted_flag) return false;
+            if (condition()) return true;
+            changed.wait(lock);
+        }
+    }
+
+    /**
+     * \brief waits until value is moved into queue.
+     * \return false if the pipeline has been aborted.
+     */
+    template <class T>
+    bool push(bounded_queue<T>& queue, T& value) {
+        if (!wait([&queue, &value] {return queue.try_push(value);})) return false;
+        notify();
+        return true;
+    }
+
+    /**
+     * \brief waits for the next element of queue.
+     * \return false if the pipeline has been aborted.
+     */
+    template <class T>
+    bool pop(bounded_queue<T>& queue, T& value) {
+        if (!wait([&queue, &value] {return queue.try_pop(value);})) return false;
+        notify();
+        return true;
+    }
+};
+
+#endif /* PLUGINS_BOUNDED_QUEUE_HPP_ */
@@ -0,0 +1,355 @@
+/*
+ * location_index.hpp
+ *
+ * Hash index from node locations to osm ids.
+ */
+
+#ifndef PLUGINS_LOCATION_INDEX_HPP_
+#define PLUGINS_LOCATION_INDEX_HPP_
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <osmium/io/error.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+/**
+ * \brief Storage of location indices.
+ *        memory: anonymous memory.
+ *        mmap: memory mapped temporary files, which the kernel writes back to disk if memory
+ *              gets short. Slower, but the conversion doesn't run out of memory.
+ */
+enum class location_index_backend {
+    memory, mmap
+};
+
+/**
+ * \brief finalizer of MurmurHash3, spreads neighbouring keys over all bits.
+ */
+inline uint64_t mix64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * \brief Zero initialized fixed size array of trivially copyable elements in mapped memory.
+ *        With location_index_backend::mmap the array lives in an unlinked file in dir.
+ */
+template <class T>
+class mmap_array {
+    T* data_ptr;
+    size_t data_size;
+
+    size_t bytes() const {
+        return data_size * sizeof(T);
+    }
+
+    void* map_file(const boost::filesystem::path& dir) {
+        std::string name = (dir / "comm2osm-index-XXXXXX").string();
+        int fd = mkstemp(&name[0]);
+        if (fd == -1) throw(osmium::io_error("could not create index file in " + dir.string()));
+        // the file is removed as soon as it is unmapped
+        unlink(name.c_str());
+        if (ftruncate(fd, bytes()) == -1) {
+            close(fd);
+            throw(osmium::io_error("could not resize index file in " + dir.string()));
+        }
+        void* ptr = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        return ptr;
+    }
+
+public:
+    mmap_array() :
+            data_ptr(nullptr), data_size(0) {
+    }
+
+    mmap_array(size_t size, location_index_backend backend, const boost::filesystem::path& dir) :
+            data_ptr(nullptr), data_size(size) {
+        if (size == 0) return;
+        void* ptr;
+        if (backend == location_index_backend::mmap) ptr = map_file(dir);
+        else ptr = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) throw(osmium::io_error("could not map index of " + std::to_string(bytes()) + " bytes"));
+        data_ptr = static_cast<T*>(ptr);
+    }
+
+    ~mmap_array() {
+        if (data_ptr) munmap(data_ptr, bytes());
+    }
+
+    mmap_array(const mmap_array&) = delete;
+    mmap_array& operator=(const mmap_array&) = delete;
+
+    mmap_array(mmap_array&& other) :
+            data_ptr(other.data_ptr), data_size(other.data_size) {
+        other.data_ptr = nullptr;
+        other.data_size = 0;
+    }
+
+    mmap_array& operator=(mmap_array&& other) {
+        std::swap(data_ptr, other.data_ptr);
+        std::swap(data_size, other.data_size);
+        return *this;
+    }
+
+    size_t size() const {
+        return data_size;
+    }
+
+    T& operator[](size_t i) {
+        assert(i < data_size);
+        return data_ptr[i];
+    }
+
+    const T& operator[](size_t i) const {
+        assert(i < data_size);
+        return data_ptr[i];
+    }
+};
+
+/**
+ * \brief Maps locations to osm ids with an open addressing hash table (linear probing).
+ *
+ *        Locations are packed into 64 bit keys and stored together with their ids in one
+ *        flat array, so a lookup usually costs a single cache miss. The table doubles when
+ *        it is filled to 3/4; reserve() avoids rehashing if the number of entries is known.
+ *        Entries can't be erased. Concurrent lookups are safe as long as nobody inserts.
+ *        The array is kept in memory or in a temporary file (see location_index_backend).
+ */
+class location_id_index {
+public:
+    typedef osmium::unsigned_object_id_type id_type;
+
+private:
+    struct entry {
+        uint64_t key;
+        id_type id;
+    };
+
+    // packed osmium::Location() (undefined coordinates), can't be a valid location
+    static constexpr uint64_t undefined_location = (uint64_t(uint32_t(osmium::Location::undefined_coordinate)) << 32)
+            | uint32_t(osmium::Location::undefined_coordinate);
+    // keys of valid locations are never zero, so zero filled memory is an empty table
+    static constexpr uint64_t empty_key = 0;
+    static constexpr size_t min_capacity = 16;
+
+    location_index_backend backend;
+    boost::filesystem::path dir;
+    mmap_array<entry> entries;
+    size_t mask;
+    size_t count;
+
+    static uint64_t pack(const osmium::Location& location) {
+        return ((uint64_t(uint32_t(location.x())) << 32) | uint32_t(location.y())) ^ undefined_location;
+    }
+
+    // spreads neighbouring coordinates over the table
+    static uint64_t hash(uint64_t key) {
+        return mix64(key);
+    }
+
+    static size_t capacity_for(size_t size) {
+        size_t capacity = min_capacity;
+        while (capacity / 4 * 3 < size)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    // returns slot of key or the empty slot where key would be inserted
+    size_t slot(uint64_t key) const {
+        size_t i = hash(key) & mask;
+        while (entries[i].key != key && entries[i].key != empty_key)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    // moves all entries into a new table with capacity slots in storage of backend
+    void rehash(size_t capacity, location_index_backend backend, const boost::filesystem::path& dir) {
+        mmap_array<entry> old_entries(capacity, backend, dir);
+        std::swap(old_entries, entries);
+        mask = capacity - 1;
+        for (size_t i = 0; i < old_entries.size(); i++)
+            if (old_entries[i].key != empty_key) entries[slot(old_entries[i].key)] = old_entries[i];
+    }
+
+    void rehash(size_t capacity) {
+        rehash(capacity, backend, dir);
+    }
+
+public:
+    explicit location_id_index(size_t expected_size = 0, location_index_backend backend =
+            location_index_backend::memory, const boost::filesystem::path& dir = boost::filesystem::path()) :
+            backend(backend), dir(dir), entries(capacity_for(expected_size), backend, dir), mask(entries.size() - 1),
+            count(0) {
+    }
+
+    /**
+     * \brief moves the table to the storage of backend. Files of the mmap backend are created in dir.
+     */
+    void set_backend(location_index_backend backend, const boost::filesystem::path& dir) {
+        rehash(entries.size(), backend, dir);
+        this->backend = backend;
+        this->dir = dir;
+    }
+
+    /**
+     * \brief grows the table so that size entries fit without rehashing.
+     */
+    void reserve(size_t size) {
+        if (capacity_for(size) > entries.size()) rehash(capacity_for(size));
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /**
+     * \return pointer to the id of location or nullptr if location isn't indexed.
+     */
+    const id_type* find(const osmium::Location& location) const {
+        const entry& e = entries[slot(pack(location))];
+        return e.key == empty_key ? nullptr : &e.id;
+    }
+
+    /**
+     * \return id of location. throws std::out_of_range if location isn't indexed.
+     */
+    id_type at(const osmium::Location& location) const {
+        const id_type* id = find(location);
+        if (!id) throw std::out_of_range("location_id_index::at");
+        return *id;
+    }
+
+    /**
+     * \brief adds location with id. Existing entries aren't overwritten (like std::map::insert).
+     * \return true if location has been inserted.
+     */
+    bool insert(const osmium::Location& location, id_type id) {
+        assert(location != osmium::Location());
+        uint64_t key = pack(location);
+        size_t i = slot(key);
+        if (entries[i].key == key) return false;
+        if (count + 1 > entries.size() / 4 * 3) {
+            rehash(entries.size() * 2);
+            i = slot(key);
+        }
+        entries[i] = entry { key, id };
+        count++;
+        return true;
+    }
+
+    /**
+     * \brief calls func(location, id) for all entries in unspecified order.
+     */
+    template <class TFunction>
+    void for_each(TFunction func) const {
+        for (size_t i = 0; i < entries.size(); i++) {
+            uint64_t key = entries[i].key;
+            if (key == empty_key) continue;
+            key ^= undefined_location;
+            func(osmium::Location(int32_t(key >> 32), int32_t(key)), entries[i].id);
+        }
+    }
+
+    void clear() {
+        entries = mmap_array<entry>(min_capacity, backend, dir);
+        mask = min_capacity - 1;
+        count = 0;
+    }
+};
+
+/**
+ * \brief Maps pairs of location and level to osm ids with one location_id_index per level.
+ *        Tables of levels are created when their first entry is inserted.
+ */
+class location_level_id_index {
+public:
+    typedef location_id_index::id_type id_type;
+
+private:
+    location_index_backend backend;
+    boost::filesystem::path dir;
+    std::map<short, location_id_index> levels;
+
+public:
+    location_level_id_index() :
+            backend(location_index_backend::memory) {
+    }
+
+    void set_backend(location_index_backend backend, const boost::filesystem::path& dir) {
+        this->backend = backend;
+        this->dir = dir;
+        for (auto& level : levels)
+            level.second.set_backend(backend, dir);
+    }
+
+    size_t size() const {
+        size_t size = 0;
+        for (auto& level : levels)
+            size += level.second.size();
+        return size;
+    }
+
+    /**
+     * \return pointer to the id of location on level or nullptr if it isn't indexed.
+     */
+    const id_type* find(const osmium::Location& location, short level) const {
+        auto it = levels.find(level);
+        if (it == levels.end()) return nullptr;
+        return it->second.find(location);
+    }
+
+    /**
+     * \return id of location on level. throws std::out_of_range if it isn't indexed.
+     */
+    id_type at(const osmium::Location& location, short level) const {
+        const id_type* id = find(location, level);
+        if (!id) throw std::out_of_range("location_level_id_index::at");
+        return *id;
+    }
+
+    /**
+     * \brief adds location on level with id. Existing entries aren't overwritten.
+     * \return true if location has been inserted.
+     */
+    bool insert(const osmium::Location& location, short level, id_type id) {
+        auto it = levels.find(level);
+        if (it == levels.end()) it = levels.emplace(level, location_id_index(0, backend, dir)).first;
+        return it->second.insert(location, id);
+    }
+
+    /**
+     * \brief calls func(location, level, id) for all entries, ordered by level.
+     */
+    template <class TFunction>
+    void for_each(TFunction func) const {
+        for (auto& level : levels)
+            level.second.for_each([&func, &level](const osmium::Location& location, id_type id) {
+                func(location, level.first, id);
+            });
+    }
+
+    void clear() {
+        levels.clear();
+    }
+};
+
+#endif /* PLUGINS_LOCATION_INDEX_HPP_ */
@@ -10,7 +10,15 @@
 #ifndef NAVTEQ_HPP_
 #define NAVTEQ_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <iostream>
+#include <thread>
+#include <unordered_map>
 
 #include <gdal/ogrsf_frmts.h>
 
@@ -24,7 +32,13 @@
 
 #include "comm2osm_exceptions.hpp"
 #include "navteq2osm_tag_parser.hpp"
+#include "../bounded_queue.hpp"
+#include "../location_index.hpp"
+#include "../offset_curve.hpp"
 #include "../readers.hpp"
+#include "../stats.hpp"
+#include "../task_graph.hpp"
+#include "../writers.hpp"
 #include "navteq_util.hpp"
 #include "navteq_mappings.hpp"
 #include "navteq_types.hpp"
@@ -34,23 +48,30 @@
 static constexpr int buffer_size = 10 * 1000 * 1000;
 
 // maps location of way end nodes to node ids
-node_map_type g_way_end_points_map;
-
+location_id_index g_way_end_points_map;
+// maps location and z-level of way end nodes with non-zero z-level to node ids
 z_lvl_nodes_map_type g_z_lvl_nodes_map;
 
 // stores osm objects, grows if needed.
-osmium::memory::Buffer g_node_buffer(buffer_size);
-osmium::memory::Buffer g_way_buffer(buffer_size);
-osmium::memory::Buffer g_rel_buffer(buffer_size);
+// objects are created per thread, street workers are merged by merge_street_worker_result().
+thread_local osmium::memory::Buffer g_node_buffer(buffer_size);
+thread_local osmium::memory::Buffer g_way_buffer(buffer_size);
+thread_local osmium::memory::Buffer g_rel_buffer(buffer_size);
 
 // id counter for object creation
-osmium::unsigned_object_id_type g_osm_id = 1;
+thread_local osmium::unsigned_object_id_type g_osm_id = 1;
+
+// ways and end nodes of navteq links in the order they are built, sorted by sort_link_ways() after the street pass.
+// turn restrictions are resolved with it, so g_way_buffer can be written before.
+thread_local link_ways_vector_type g_link_ways;
 
-// g_link_id_map maps navteq link_ids to a vector of osm_ids (it will mostly map to a single osm_id)
-link_id_map_type g_link_id_map;
+// set in streaming mode to receive buffers while converting.
+// only set for the main thread, street workers keep their objects until they are merged.
+thread_local streaming_osm_writer* g_osm_writer = nullptr;
 
-// Provides access to elements in g_way_buffer through offsets
-osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, size_t> g_way_offset_map;
+// set if statistics of the conversion phases are requested (--stats)
+conversion_stats* g_stats = nullptr;
+std::mutex g_stats_mutex;
 
 // data structure to store admin boundary tags
 struct mtd_area_dataset {
@@ -67,14 +88,106 @@ struct mtd_area_dataset {
 // auxiliary map which maps datasets with tags for administrative boundaries
 std::map<osmium::unsigned_object_id_type, mtd_area_dataset> g_mtd_area_map;
 
-// map for conditional modifications
-cnd_mod_map_type g_cnd_mod_map;
+// dimension and weight restrictions of CndMod.dbf until init_link_restrictions(), other modifications aren't kept
+cnd_mod_vector_type g_cnd_mod_rows;
 
-// map for conditional driving manoeuvres
+// conditional driving manoeuvres of Cdms.dbf (conditions of links and types of conditions)
 cdms_map_type g_cdms_map;
+// smallest restrictions of links, joined from g_cdms_map and g_cnd_mod_rows by init_link_restrictions()
+link_restrictions_index g_link_restrictions;
 std::map<area_id_type, govt_code_type> g_area_to_govt_code_map;
 cntry_ref_map_type g_cntry_ref_map;
 
+/**
+ * \brief hands g_node_buffer to g_osm_writer once it is half full (streaming mode only).
+ */
+void flush_node_buffer() {
+    if (g_osm_writer && g_node_buffer.committed() > buffer_size / 2) g_osm_writer->write_nodes(g_node_buffer);
+}
+
+/**
+ * \brief spools g_way_buffer once it is half full (streaming mode only).
+ */
+void flush_way_buffer() {
+    if (g_osm_writer && g_way_buffer.committed() > buffer_size / 2) g_osm_writer->write_ways(g_way_buffer);
+}
+
+/**
+ * \brief spools g_rel_buffer once it is half full (streaming mode only).
+ */
+void flush_rel_buffer() {
+    if (g_osm_writer && g_rel_buffer.committed() > buffer_size / 2) g_osm_writer->write_relations(g_rel_buffer);
+}
+
+/**
+ * \brief starts recording a phase of the conversion in g_stats (main thread only).
+ */
+void begin_phase(const char* name) {
+    if (g_stats) g_stats->begin(name, g_osm_id);
+}
+
+/**
+ * \brief ends the phase started by begin_phase(). Objects are counted by g_osm_id.
+ */
+void end_phase() {
+    if (g_stats) g_stats->end(g_osm_id);
+}
+
+/**
+ * \brief adds processed features or records to the running phase. May be called by several threads.
+ */
+void count_rows(uint64_t rows) {
+    if (!g_stats) return;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    g_stats->add_rows(rows);
+}
+
+/**
+ * \brief adds objects which aren't counted by g_osm_id (e.g. of child processes) to the running phase.
+ */
+void count_objects(uint64_t objects) {
+    if (!g_stats) return;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    g_stats->add_objects(objects);
+}
+
+/**
+ * \brief adds a way of link_id to g_link_ways.
+ *        Ways of a link are built one after the other, so they extend the last entry. Links whose ways
+ *        aren't consecutive (duplicate link ids) get another entry.
+ * \param front first node of the way.
+ * \param back last node of the way.
+ */
+void add_link_way(link_id_type link_id, osmium::unsigned_object_id_type way_id, const osmium::NodeRef& front,
+        const osmium::NodeRef& back) {
+    if (!g_link_ways.empty() && g_link_ways.back().link_id == link_id && g_link_ways.back().last_way_id + 1 == way_id) {
+        g_link_ways.back().last_way_id = way_id;
+        g_link_ways.back().back = back;
+    } else {
+        g_link_ways.push_back(link_ways_type { link_id, way_id, way_id, front, back });
+    }
+}
+
+/**
+ * \brief sorts g_link_ways by link_id. Entries of duplicate link ids keep their order.
+ */
+void sort_link_ways() {
+    std::stable_sort(g_link_ways.begin(), g_link_ways.end(), [](const link_ways_type& lhs, const link_ways_type& rhs) {
+        return lhs.link_id < rhs.link_id;
+    });
+}
+
+/**
+ * \brief looks up link_id in g_link_ways, which has to be sorted.
+ * \return ways of link_id or nullptr if no ways have been built for it.
+ */
+const link_ways_type* find_link_ways(link_id_type link_id) {
+    auto it = std::lower_bound(g_link_ways.cbegin(), g_link_ways.cend(), link_id,
+            [](const link_ways_type& link, link_id_type id) {return link.link_id < id;});
+    if (it == g_link_ways.cend() || it->link_id != link_id) return nullptr;
+    return &*it;
+}
+
 /**
  * \brief Dummy attributes enable josm to read output xml files.
  *
@@ -90,47 +203,34 @@ void set_dummy_osm_object_attributes(osmium::OSMObject& obj) {
 /**
  * \brief adds mutual node of two ways as via role (required)
  *
- * \param osm_ids vector with osm_ids of ways which belong to the turn restriction
+ * \param from link of the from way
+ * \param to link of the to way
  * \param rml_builder relation member list builder of turn restriction
  */
 
-void add_common_node_as_via(const osm_id_vector_type& osm_ids, osmium::builder::RelationMemberListBuilder& rml_builder) {
-    assert(osm_ids.size() == 2);
-
-    const osmium::Way &from_way = g_way_buffer.get<const osmium::Way>(g_way_offset_map.get(osm_ids.at(0)));
-    auto from_way_front = from_way.nodes().front().location();
-    auto from_way_back = from_way.nodes().back().location();
-
-    const osmium::Way &to_way = g_way_buffer.get<const osmium::Way>(g_way_offset_map.get(osm_ids.at(1)));
-    auto to_way_front = to_way.nodes().front().location();
-    auto to_way_back = to_way.nodes().back().location();
-
-    if (from_way_front == to_way_front) {
-        if (g_way_end_points_map.find(from_way_front) == g_way_end_points_map.end()) {
-            std::cerr << "Skipping via node: " << from_way_front << " is not in g_way_end_points_map." << std::endl;
-            return;
-        }
-        rml_builder.add_member(osmium::item_type::node, g_way_end_points_map.at(from_way_front), "via");
-    } else if (from_way_front == to_way_back) {
-        if (g_way_end_points_map.find(from_way_front) == g_way_end_points_map.end()) {
-            std::cerr << "Skipping via node: " << from_way_front << " is not in g_way_end_points_map." << std::endl;
-            return;
-        }
-        rml_builder.add_member(osmium::item_type::node, g_way_end_points_map.at(from_way_front), "via");
-    } else if (from_way_back == to_way_front) {
-        if (g_way_end_points_map.find(from_way_back) == g_way_end_points_map.end()) {
-            std::cerr << "Skipping via node: " << from_way_back << " is not in g_way_end_points_map." << std::endl;
-            return;
-        }
-        rml_builder.add_member(osmium::item_type::node, g_way_end_points_map.at(from_way_back), "via");
+void add_common_node_as_via(const link_ways_type& from, const link_ways_type& to,
+        osmium::builder::RelationMemberListBuilder& rml_builder) {
+    osmium::NodeRef from_node, to_node;
+    if (from.front.location() == to.front.location()) {
+        from_node = from.front;
+        to_node = to.front;
+    } else if (from.front.location() == to.back.location()) {
+        from_node = from.front;
+        to_node = to.back;
+    } else if (from.back.location() == to.front.location()) {
+        from_node = from.back;
+        to_node = to.front;
     } else {
-        if (g_way_end_points_map.find(from_way_back) == g_way_end_points_map.end()) {
-            std::cerr << "Skipping via node: " << from_way_back << " is not in g_way_end_points_map." << std::endl;
-            return;
-        }
-        rml_builder.add_member(osmium::item_type::node, g_way_end_points_map.at(from_way_back), "via");
-        assert(from_way_back == to_way_back);
+        assert(from.back.location() == to.back.location());
+        from_node = from.back;
+        to_node = to.back;
+    }
+    // ways with different z-levels at their common location don't share the node
+    if (from_node.ref() != to_node.ref()) {
+        std::cerr << "Skipping via node: ways don't share a node at " << from_node.location() << "." << std::endl;
+        return;
     }
+    rml_builder.add_member(osmium::item_type::node, from_node.ref(), "via");
 }
 
 /**
@@ -139,9 +239,10 @@ void add_common_node_as_via(const osm_id_vector_type& osm_ids, osmium::builder::
  * 			the order of *links is important to assign the correct role.
  *
  * \param osm_ids vector with osm_ids of ways which belong to the turn restriction
+ * \param link_ids links of the turn restriction, the first one is the from link, the last one the to link.
  * \return Last number of committed bytes to m_buffer before this commit.
  */
-size_t build_turn_restriction(const osm_id_vector_type& osm_ids) {
+size_t build_turn_restriction(const osm_id_vector_type& osm_ids, const link_id_vector_type& link_ids) {
 
     osmium::builder::RelationBuilder builder(g_rel_buffer);
     STATIC_RELATION(builder.object()).set_id(std::to_string(g_osm_id++).c_str());
@@ -156,7 +257,9 @@ size_t build_turn_restriction(const osm_id_vector_type& osm_ids) {
         rml_builder.add_member(osmium::item_type::way, osm_ids.at(0), "from");
         for (int i = 1; i < osm_ids.size() - 1; i++)
             rml_builder.add_member(osmium::item_type::way, osm_ids.at(i), "via");
-        if (osm_ids.size() == 2) add_common_node_as_via(osm_ids, rml_builder);
+        // two ways belong to two links with one way each
+        if (osm_ids.size() == 2)
+            add_common_node_as_via(*find_link_ways(link_ids.front()), *find_link_ways(link_ids.back()), rml_builder);
         rml_builder.add_member(osmium::item_type::way, osm_ids.at(osm_ids.size() - 1), "to");
 
         osmium::builder::TagListBuilder tl_builder(g_rel_buffer, &builder);
@@ -178,7 +281,7 @@ link_id_type build_tag_list(ogr_feature_uptr& feat, osmium::builder::Builder* bu
         short z_level = -5) {
     osmium::builder::TagListBuilder tl_builder(buf, builder);
 
-    link_id_type link_id = parse_street_tags(&tl_builder, feat, &g_cdms_map, &g_cnd_mod_map, &g_area_to_govt_code_map,
+    link_id_type link_id = parse_street_tags(&tl_builder, feat, &g_link_restrictions, &g_area_to_govt_code_map,
             &g_cntry_ref_map);
 
     if (z_level != -5 && z_level != 0) tl_builder.add_tag("layer", std::to_string(z_level).c_str());
@@ -223,26 +326,16 @@ osmium::unsigned_object_id_type build_node_with_tag(osmium::Location location, c
 }
 
 /**
- * \brief gets id from Node with location. creates Node if missing.
- * \param location Location of Node being created.
- * \return id of found or created Node.
- */
-osmium::unsigned_object_id_type get_node(osmium::Location location) {
-    auto it = g_way_end_points_map.find(location);
-    if (it != g_way_end_points_map.end()) return it->second;
-    return build_node(location);
-}
-
-/**
- * \brief adds WayNode to Way.
+ * \brief gets id of a WayNode from the Nodes of the way or the way end points.
  * \param location Location of WayNode
- * \param wnl_builder Builder to create WayNode
- * \param node_ref_map holds Node ids suitable to given Location.
+ * \param node_ref_map holds Node ids of the way suitable to given Location.
+ * \param is_end_point true if location is taken from g_way_end_points_map.
  */
-void add_way_node(const osmium::Location& location, osmium::builder::WayNodeListBuilder& wnl_builder,
-        node_map_type* node_ref_map) {
+osmium::unsigned_object_id_type get_way_node_id(const osmium::Location& location, node_map_type* node_ref_map,
+        bool is_end_point) {
+    if (is_end_point) return g_way_end_points_map.at(location);
     assert(node_ref_map);
-    wnl_builder.add_node_ref(osmium::NodeRef(node_ref_map->at(location), location));
+    return node_ref_map->at(location);
 }
 
 static std::set<short> z_lvl_set = { -4, -3, -2, -1, 0, 1, 2, 3, 4, 5 };
@@ -251,16 +344,45 @@ void test__z_lvl_range(short z_lvl) {
         throw(out_of_range_exception("z_lvl " + std::to_string(z_lvl) + " is not valid"));
 }
 
+// scratch buffer of resolve_node_refs(), reused for all links of a thread
+thread_local node_ref_vector_type g_link_node_refs;
+
 /**
- * \brief creates way with tags in m_buffer.
- * \param ogr_ls provides geometry (linestring) for the way.
+ * \brief converts the vertices of a link to NodeRefs once, so the ways of the link are built from index
+ *        ranges of node_refs without converting or looking up a vertex again.
+ * \param line linestring of the link.
  * \param node_ref_map provides osm_ids of Nodes to a given location.
- * \param is_sub_linestring true if given linestring is a sublinestring.
+ * \param has_sub_linestrings true if the link is split by z-levels. Then every vertex is looked up in
+ *        node_ref_map first, otherwise only the end points are taken from g_way_end_points_map.
+ */
+void resolve_node_refs(const polyline_span& line, node_map_type* node_ref_map, bool has_sub_linestrings,
+        node_ref_vector_type& node_refs) {
+    node_refs.clear();
+    node_refs.reserve(line.size());
+    for (size_t i = 0; i < line.size(); i++) {
+        osmium::Location location = line.location(i);
+        bool is_end_point = i == 0 || i == line.size() - 1;
+        bool use_end_points_map;
+        if (!has_sub_linestrings) {
+            use_end_points_map = is_end_point;
+        } else {
+            use_end_points_map = node_ref_map->find(location) == node_ref_map->end();
+            // node has to be in node_ref_map or way_end_points_map
+            assert(!use_end_points_map || g_way_end_points_map.find(location));
+        }
+        node_refs.emplace_back(get_way_node_id(location, node_ref_map, use_end_points_map), location);
+    }
+}
+
+/**
+ * \brief creates way with tags in m_buffer.
+ * \param node_refs provides Nodes and geometry of the way.
+ * \param is_sub_linestring true if the way is a part of its link.
  * \param z_lvl z-level of way. initially invalid (-5).
  * \return id of created Way.
  */
-osmium::unsigned_object_id_type build_way(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls, node_map_type *node_ref_map =
-        nullptr, bool is_sub_linestring = false, short z_lvl = -5) {
+osmium::unsigned_object_id_type build_way(ogr_feature_uptr& feat, const node_ref_span& node_refs,
+        bool is_sub_linestring = false, short z_lvl = -5) {
 
     if (is_sub_linestring) test__z_lvl_range(z_lvl);
 
@@ -270,47 +392,29 @@ osmium::unsigned_object_id_type build_way(ogr_feature_uptr& feat, ogr_line_strin
 
     builder.add_user(USER);
     osmium::builder::WayNodeListBuilder wnl_builder(g_way_buffer, &builder);
-    for (int i = 0; i < ogr_ls->getNumPoints(); i++) {
-        osmium::Location location(ogr_ls->getX(i), ogr_ls->getY(i));
-        bool is_end_point = i == 0 || i == ogr_ls->getNumPoints() - 1;
-        std::map<osmium::Location, osmium::unsigned_object_id_type> *map_containing_node;
-        if (!is_sub_linestring) {
-            if (is_end_point) map_containing_node = &g_way_end_points_map;
-            else map_containing_node = node_ref_map;
-        } else {
-            if (node_ref_map->find(location) != node_ref_map->end()) {
-                map_containing_node = node_ref_map;
-            } else {
-                // node has to be in node_ref_map or way_end_points_map
-                assert(g_way_end_points_map.find(location) != g_way_end_points_map.end());
-                map_containing_node = &g_way_end_points_map;
-            }
-        }
-        add_way_node(location, wnl_builder, map_containing_node);
-    }
+    for (auto& node_ref : node_refs)
+        wnl_builder.add_node_ref(node_ref);
 
     link_id_type link_id = build_tag_list(feat, &builder, g_way_buffer, z_lvl);
     assert(link_id != 0);
-    if (g_link_id_map.find(link_id) == g_link_id_map.end())
-        g_link_id_map.insert(std::make_pair(link_id, osm_id_vector_type()));
-    g_link_id_map.at(link_id).push_back((osmium::unsigned_object_id_type) STATIC_WAY(builder.object()).id());
+    osmium::unsigned_object_id_type way_id = STATIC_WAY(builder.object()).id();
+    add_link_way(link_id, way_id, node_refs.front(), node_refs.back());
 
-    return STATIC_WAY(builder.object()).id();
+    return way_id;
 }
 
 /**
- * \brief  creates a sublinestring from ogr_ls from range [start_index, end_index] inclusive
- * \param ogr_ls Linestring from which the sublinestring is taken from.
- * \param start_index Node index in ogr_ls, where sublinestring will begin.
- * \param end_index Node index in ogr_ls, where sublinestring will end.
- * \return sublinestring from ogr_ls [start_index, end_index] inclusive
+ * \brief creates way with tags in m_buffer.
+ * \param line provides geometry (linestring) for the way.
+ * \param node_ref_map provides osm_ids of Nodes to a given location.
+ * \param is_sub_linestring true if given linestring is a sublinestring.
+ * \param z_lvl z-level of way. initially invalid (-5).
+ * \return id of created Way.
  */
-OGRLineString create_sublinestring_geometry(ogr_line_string_uptr& ogr_ls, int start_index, int end_index = -1) {
-    assert(start_index < end_index || end_index == -1);
-    assert(start_index < ogr_ls->getNumPoints());
-    OGRLineString ogr_sub_ls;
-    ogr_sub_ls.addSubLineString(ogr_ls.get(), start_index, end_index);
-    return ogr_sub_ls;
+osmium::unsigned_object_id_type build_way(ogr_feature_uptr& feat, const polyline_span& line, node_map_type *node_ref_map =
+        nullptr, bool is_sub_linestring = false, short z_lvl = -5) {
+    resolve_node_refs(line, node_ref_map, is_sub_linestring, g_link_node_refs);
+    return build_way(feat, node_ref_span(g_link_node_refs), is_sub_linestring, z_lvl);
 }
 
 /* helpers for split_way_by_z_level */
@@ -337,20 +441,16 @@ bool is_superior_or_equal(short superior, short than) {
 }
 
 /**
- * \brief splits a OGRLinestring by index.
+ * \brief splits a linestring by index.
  * \param start_index index where sub_way begins.
  * \param end_index index where sub_way ends.
- * \param ogr_ls geometry of index.
- * \param node_ref_map provides osm_ids of Nodes to a given location.
+ * \param node_refs resolved Nodes of the linestring.
  * \param z_lvl
  */
-void build_sub_way_by_index(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls, ushort start_index, ushort end_index,
-        node_map_type* node_ref_map, short z_lvl = 0) {
-    ogr_line_string_uptr ogr_sub_ls_uptr(
-            new OGRLineString(create_sublinestring_geometry(ogr_ls, start_index, end_index)));
-    osmium::unsigned_object_id_type way_id = build_way(feat, ogr_sub_ls_uptr, node_ref_map, true, z_lvl);
-
-    g_way_offset_map.set(way_id, g_way_buffer.commit());
+void build_sub_way_by_index(ogr_feature_uptr& feat, const node_ref_span& node_refs, ushort start_index,
+        ushort end_index, short z_lvl = 0) {
+    build_way(feat, node_refs.sub(start_index, end_index), true, z_lvl);
+    g_way_buffer.commit();
 }
 
 /**
@@ -360,13 +460,11 @@ void build_sub_way_by_index(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls
  * \param last_index index of the last node in given way
  * \param link_id for debug only
  * \param node_z_level_vector holds [index, z_level] pairs to process
- * \param ogr_ls given way which has to be splitted
- * \param node_ref_map location to osm_id mapping (to preserve uniqueness of node locations)
+ * \param node_refs resolved Nodes of the way which has to be splitted (see resolve_node_refs())
  * \return start_index
  */
-ushort create_continuing_sub_ways(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls, ushort first_index, ushort start_index, ushort last_index,
-        uint link_id, const index_z_lvl_vector_type& node_z_level_vector,
-        node_map_type* node_ref_map) {
+ushort create_continuing_sub_ways(ogr_feature_uptr& feat, const node_ref_span& node_refs, ushort first_index,
+        ushort start_index, ushort last_index, uint link_id, const z_lvl_range& node_z_level_vector) {
 
     for (auto it = node_z_level_vector.cbegin(); it != node_z_level_vector.cend(); ++it) {
         short z_lvl = it->second;
@@ -414,12 +512,12 @@ ushort create_continuing_sub_ways(ogr_feature_uptr& feat, ogr_line_string_uptr&
                 std::cout << " 2 ## " << link_id << " ## " << from << "/" << last_index << "  -  " << to << "/"
                         << last_index << ": \tz_lvl=" << z_lvl << std::endl;
             if (from < to) {
-                build_sub_way_by_index(feat, ogr_ls, from, to, node_ref_map, z_lvl);
+                build_sub_way_by_index(feat, node_refs, from, to, z_lvl);
                 start_index = to;
             }
 
             if (not_last_element && to < next_index - 1) {
-                build_sub_way_by_index(feat, ogr_ls, to, next_index - 1, node_ref_map);
+                build_sub_way_by_index(feat, node_refs, to, next_index - 1);
                 if (DEBUG)
                     std::cout << " 3 ## " << link_id << " ## " << to << "/" << last_index << "  -  " << next_index - 1
                             << "/" << last_index << ": \tz_lvl=" << 0 << std::endl;
@@ -432,17 +530,20 @@ ushort create_continuing_sub_ways(ogr_feature_uptr& feat, ogr_line_string_uptr&
 
 /**
  * \brief splits a given linestring into sub_ways to be able to apply z_levels.
- * \param ogr_ls Linestring to be splitted.
+ * \param line Linestring to be splitted.
  * \param node_z_level_vector holds pairs of Node indices in linestring and their z_level.
  * 							  ommited indices imply default value of 0.
  * \param node_ref_map provides osm_ids of Nodes to a given location.
  * \param link_id link_id of processed feature - for debug only.
  */
-void split_way_by_z_level(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls,
-        const index_z_lvl_vector_type& node_z_level_vector, node_map_type *node_ref_map, uint link_id) {
+void split_way_by_z_level(ogr_feature_uptr& feat, const polyline_span& line,
+        const z_lvl_range& node_z_level_vector, node_map_type *node_ref_map, uint link_id) {
 
-    ushort first_index = 0, last_index = ogr_ls->getNumPoints() - 1;
+    ushort first_index = 0, last_index = line.size() - 1;
     ushort start_index = node_z_level_vector.cbegin()->first;
+    // all sub ways share the Nodes of the line
+    resolve_node_refs(line, node_ref_map, true, g_link_node_refs);
+    node_ref_span node_refs(g_link_node_refs);
     if (start_index > 0) start_index--;
 
     // first_index <= start_index < end_index <= last_index
@@ -451,17 +552,17 @@ void split_way_by_z_level(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls,
 
 //	if (DEBUG) print_z_level_map(link_id, true);
     if (first_index != start_index) {
-        build_sub_way_by_index(feat, ogr_ls, first_index, start_index, node_ref_map);
+        build_sub_way_by_index(feat, node_refs, first_index, start_index);
         if (DEBUG)
             std::cout << " 1 ## " << link_id << " ## " << first_index << "/" << last_index << "  -  " << start_index
                     << "/" << last_index << ": \tz_lvl=" << 0 << std::endl;
     }
 
-    start_index = create_continuing_sub_ways(feat, ogr_ls, first_index, start_index, last_index, link_id, node_z_level_vector,
-            node_ref_map);
+    start_index = create_continuing_sub_ways(feat, node_refs, first_index, start_index, last_index, link_id,
+            node_z_level_vector);
 
     if (start_index < last_index) {
-        build_sub_way_by_index(feat, ogr_ls, start_index, last_index, node_ref_map);
+        build_sub_way_by_index(feat, node_refs, start_index, last_index);
         if (DEBUG)
             std::cout << " 4 ## " << link_id << " ## " << start_index << "/" << last_index << "  -  " << last_index
                     << "/" << last_index << ": \tz_lvl=" << 0 << std::endl;
@@ -474,45 +575,54 @@ void split_way_by_z_level(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls,
  ****************************************************/
 
 /**
- * \brief determines osm_id for end_point. If it doesn't exist it will be created.
+ * \brief returns z-level of the first node of a way with z-levels.
  */
+z_lvl_type get_first_z_lvl(const z_lvl_range& index_z_lvl_vector) {
+    auto first_point_with_different_z_lvl = index_z_lvl_vector.at(0);
+    if (first_point_with_different_z_lvl.first == 0) return first_point_with_different_z_lvl.second;
+    return 0;
+}
 
-void process_end_point(bool first, ushort index, z_lvl_type z_lvl, ogr_line_string_uptr& ogr_ls, z_lvl_map *z_level_map,
-        node_map_type& node_ref_map) {
-    ushort i = first ? 0 : ogr_ls->getNumPoints() - 1;
-    osmium::Location location(ogr_ls->getX(i), ogr_ls->getY(i));
+/**
+ * \brief returns z-level of the last node of a way with z-levels.
+ */
+z_lvl_type get_last_z_lvl(const z_lvl_range& index_z_lvl_vector, ushort last_index) {
+    auto last_point_with_different_z_lvl = index_z_lvl_vector.at(index_z_lvl_vector.size() - 1);
+    if (last_point_with_different_z_lvl.first == last_index) return last_point_with_different_z_lvl.second;
+    return 0;
+}
+
+/**
+ * \brief creates Node for end_point of a way with z-levels if it doesn't exist yet.
+ *        Nodes with z-level zero are shared with all ways ending there (g_way_end_points_map),
+ *        other Nodes only with ways of the same z-level (g_z_lvl_nodes_map).
+ */
+void create_z_lvl_end_point(bool first, z_lvl_type z_lvl, const polyline_span& line) {
+    osmium::Location location = line.location(first ? 0 : line.size() - 1);
 
     if (z_lvl != 0) {
-        node_id_type node_id = std::make_pair(location, z_lvl);
-        auto it = g_z_lvl_nodes_map.find(node_id);
-        if (it != g_z_lvl_nodes_map.end()) {
-            osmium::unsigned_object_id_type osm_id = it->second;
-            node_ref_map.insert(std::make_pair(location, osm_id));
-        } else {
-            osmium::unsigned_object_id_type osm_id = build_node(location);
-            node_ref_map.insert(std::make_pair(location, osm_id));
-            g_z_lvl_nodes_map.insert(std::make_pair(node_id, osm_id));
-        }
-    } else if (g_way_end_points_map.find(location) == g_way_end_points_map.end()) {
+        if (!g_z_lvl_nodes_map.find(location, z_lvl)) g_z_lvl_nodes_map.insert(location, z_lvl, build_node(location));
+    } else if (!g_way_end_points_map.find(location)) {
         // adds all zero z-level end points to g_way_end_points_map
-        g_way_end_points_map.insert(std::make_pair(location, build_node(location)));
+        g_way_end_points_map.insert(location, build_node(location));
     }
 }
 
-void process_first_end_point(ushort index, z_lvl_type z_lvl, ogr_line_string_uptr& ogr_ls, z_lvl_map *z_level_map,
-        node_map_type & node_ref_map) {
-    process_end_point(true, index, z_lvl, ogr_ls, z_level_map, node_ref_map);
-}
+/**
+ * \brief determines osm_id for end_point of a way with z-levels.
+ *        The Node has been created by create_z_lvl_end_point() before. Doesn't modify shared maps.
+ */
+void process_end_point(bool first, z_lvl_type z_lvl, const polyline_span& line, node_map_type& node_ref_map) {
+    osmium::Location location = line.location(first ? 0 : line.size() - 1);
 
-void process_last_end_point(ushort index, z_lvl_type z_lvl, ogr_line_string_uptr& ogr_ls, z_lvl_map *z_level_map,
-        node_map_type & node_ref_map) {
-    process_end_point(false, index, z_lvl, ogr_ls, z_level_map, node_ref_map);
+    // zero z-level end points are taken from g_way_end_points_map by build_way()
+    if (z_lvl != 0) node_ref_map.insert(std::make_pair(location, g_z_lvl_nodes_map.at(location, z_lvl)));
 }
 
-void middle_points_preparation(ogr_line_string_uptr& ogr_ls, node_map_type& node_ref_map) {
+void middle_points_preparation(const polyline_span& line, node_map_type& node_ref_map) {
     // creates remaining nodes required for way
-    for (int i = 1; i < ogr_ls->getNumPoints() - 1; i++) {
-        osmium::Location location(ogr_ls->getX(i), ogr_ls->getY(i));
+    for (size_t i = 1; i < line.size() - 1; i++) {
+        osmium::Location location = line.location(i);
         node_ref_map.insert(std::make_pair(location, build_node(location)));
     }
     g_node_buffer.commit();
@@ -522,41 +632,45 @@ void middle_points_preparation(ogr_line_string_uptr& ogr_ls, node_map_type& node
  * \brief replaces all z-levels by zero, which are not an endpoint
  * \param z_lvl_vec vector containing pairs of [z_lvl_index, z_lvl]
  */
-void set_ferry_z_lvls_to_zero(ogr_feature_uptr& feat, index_z_lvl_vector_type& z_lvl_vec) {
+void set_ferry_z_lvls_to_zero(const polyline_span& line, index_z_lvl_vector_type& z_lvl_vec) {
     // erase middle z_lvls
     if (z_lvl_vec.size() > 2) z_lvl_vec.erase(z_lvl_vec.begin() + 1, z_lvl_vec.end() - 1);
     // erase first z_lvl if first index references first node
     if (z_lvl_vec.size() > 0 && z_lvl_vec.begin()->first != 0) z_lvl_vec.erase(z_lvl_vec.begin());
     // erase last z_lvl if last index references last node
-    OGRLineString* ogr_ls = static_cast<OGRLineString*>(feat->GetGeometryRef());
-    if (z_lvl_vec.size() > 0 && (z_lvl_vec.end() - 1)->first != ogr_ls->getNumPoints() - 1)
+    if (z_lvl_vec.size() > 0 && (z_lvl_vec.end() - 1)->first != line.size() - 1)
         z_lvl_vec.erase(z_lvl_vec.end());
 }
 
-void create_house_numbers(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls, bool left) {
-    const char* ref_addr = left ? L_REFADDR : R_REFADDR;
-    const char* nref_addr = left ? L_NREFADDR : R_NREFADDR;
-    const char* addr_schema = left ? L_ADDRSCH : R_ADDRSCH;
+// offset curves of house number interpolations, reused for all links of a thread
+thread_local offset_curve_builder g_offset_curve_builder;
+thread_local std::vector<double> g_offset_xy;
+
+void create_house_numbers(ogr_feature_uptr& feat, const polyline_span& line, bool left) {
+    streets_field ref_addr = left ? SF_L_REFADDR : SF_R_REFADDR;
+    streets_field nref_addr = left ? SF_L_NREFADDR : SF_R_NREFADDR;
+    streets_field addr_schema = left ? SF_L_ADDRSCH : SF_R_ADDRSCH;
 
     if (!strcmp(get_field_from_feature(feat, ref_addr), "")) return;
     if (!strcmp(get_field_from_feature(feat, nref_addr), "")) return;
     if (!strcmp(get_field_from_feature(feat, addr_schema), "")) return;
     if (!strcmp(get_field_from_feature(feat, addr_schema), "M")) return;
 
-    ogr_line_string_uptr offset_ogr_ls(create_offset_curve(ogr_ls.get(), 0.00005, left));
-    assert(ogr_ls);
+    g_offset_curve_builder.build(line, 0.00005, left, g_offset_xy);
+    polyline_span offset_line(g_offset_xy.data(), g_offset_xy.size() / 2);
+    assert(offset_line.size() > 0);
     osmium::builder::WayBuilder way_builder(g_way_buffer);
     STATIC_WAY(way_builder.object()).set_id(g_osm_id++);
     set_dummy_osm_object_attributes(STATIC_OSMOBJECT(way_builder.object()));
     way_builder.add_user(USER);
     osmium::builder::WayNodeListBuilder wnl_builder(g_way_buffer, &way_builder);
-    for (int i = 0; i < offset_ogr_ls->getNumPoints(); i++) {
-        osmium::Location location(offset_ogr_ls->getX(i), offset_ogr_ls->getY(i));
+    for (size_t i = 0; i < offset_line.size(); i++) {
+        osmium::Location location = offset_line.location(i);
         assert(location.valid());
         osmium::unsigned_object_id_type node_id;
         if (i == 0) {
             node_id = build_node_with_tag(location, "addr:housenumber", get_field_from_feature(feat, ref_addr));
-        } else if (i == offset_ogr_ls->getNumPoints() - 1) {
+        } else if (i == offset_line.size() - 1) {
             node_id = build_node_with_tag(location, "addr:housenumber", get_field_from_feature(feat, nref_addr));
         } else {
             node_id = build_node(location);
@@ -573,78 +687,144 @@ void create_house_numbers(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls,
     g_way_buffer.commit();
 }
 
-void create_house_numbers(ogr_feature_uptr& feat, ogr_line_string_uptr& ogr_ls) {
-    create_house_numbers(feat, ogr_ls, true);
-    create_house_numbers(feat, ogr_ls, false);
+void create_house_numbers(ogr_feature_uptr& feat, const polyline_span& line) {
+    create_house_numbers(feat, line, true);
+    create_house_numbers(feat, line, false);
 }
 
+/**
+ * \brief returns the z-levels of the Streets links of one directory. They are looked up in z_level_map or,
+ *        without it, merge joined from Zlevels.dbf of the directory. Then only the z-levels of the
+ *        current link are kept in memory, but links have to be looked up in ascending order of
+ *        their ids and Zlevels.dbf has to be ordered by LINK_ID (see z_levels_ordered()).
+ */
+class z_lvl_reader {
+    const z_lvl_index* z_level_map;
+    std::unique_ptr<mmap_dbf_reader> dbf;
+    int link_id_field;
+    int point_num_field;
+    int z_level_field;
+    // first row of Zlevels.dbf after the current link
+    int row;
+    link_id_type link_id;
+    index_z_lvl_vector_type z_lvls;
+
+    link_id_type row_link_id(int row) const {
+        return dbf->get_int(row, link_id_field);
+    }
+
+    // moves row to the first row with a link id not less than link_id. Galloping, so workers can
+    // start in the middle of Zlevels.dbf and neighbouring links are found in a few steps.
+    void seek(link_id_type link_id) {
+        int first = row, last = row, step = 1;
+        while (last < dbf->record_count() && row_link_id(last) < link_id) {
+            first = last + 1;
+            last = first + step;
+            step *= 2;
+        }
+        last = std::min(last, dbf->record_count());
+        while (first < last) {
+            int middle = first + (last - first) / 2;
+            if (row_link_id(middle) < link_id) first = middle + 1;
+            else last = middle;
+        }
+        row = first;
+    }
+
+public:
+    z_lvl_reader(const z_lvl_index* z_level_map, const boost::filesystem::path& dir) :
+            z_level_map(z_level_map), link_id_field(-1), point_num_field(-1), z_level_field(-1), row(0), link_id(0) {
+        if (z_level_map) return;
+        dbf.reset(new mmap_dbf_reader(dir / ZLEVELS_DBF, cnull));
+        link_id_field = dbf_get_field_index(*dbf, LINK_ID);
+        point_num_field = dbf_get_field_index(*dbf, POINT_NUM);
+        z_level_field = dbf_get_field_index(*dbf, Z_LEVEL);
+    }
+
+    /**
+     * \return [index, z_lvl] pairs of link_id or an empty range if it has no z-levels.
+     *         In streaming mode the range is valid until the next call.
+     */
+    z_lvl_range find(link_id_type link_id) {
+        if (z_level_map) return z_level_map->find(link_id);
+        // links of Streets may repeat, their rows have already been read
+        if (row > 0 && link_id == this->link_id) return z_lvls;
+        assert(row == 0 || link_id > this->link_id);
+
+        this->link_id = link_id;
+        z_lvls.clear();
+        seek(link_id);
+        for (; row < dbf->record_count() && row_link_id(row) == link_id; row++) {
+            short z_level = dbf->get_int(row, z_level_field);
+            if (z_level != 0) z_lvls.push_back(std::make_pair(dbf->get_int(row, point_num_field) - 1, z_level));
+        }
+        return z_lvls;
+    }
+};
+
 /**
  * \brief creates Way from linestring.
  * 		  creates missing Nodes needed for Way and Way itself.
- * \param ogr_ls linestring which provides the geometry.
- * \param z_level_map holds z_levels to Nodes of Ways.
+ * \param line linestring which provides the geometry.
+ * \param index_z_lvl_range z-levels of the link of feat.
  */
-void process_way(ogr_feature_uptr&& feat, z_lvl_map *z_level_map) {
+void process_way(ogr_feature_uptr& feat, const polyline_span& line, const z_lvl_range& index_z_lvl_range) {
 
     node_map_type node_ref_map;
 
-    // caution! ogr_ls refers to a geometry which is part of feat => you mustn't cleanup
-    ogr_line_string_uptr ogr_ls(static_cast<OGRLineString*>(feat->GetGeometryRef()));
-
     // creates remaining nodes required for way
-    middle_points_preparation(ogr_ls, node_ref_map);
-    if (ogr_ls->getNumPoints() > 2) assert(node_ref_map.size() > 0);
+    middle_points_preparation(line, node_ref_map);
+    if (line.size() > 2) assert(node_ref_map.size() > 0);
 
-    link_id_type link_id = get_uint_from_feature(feat, LINK_ID);
+    link_id_type link_id = get_uint_from_feature(feat, SF_LINK_ID);
 
-    auto it = z_level_map->find(link_id);
-    if (it == z_level_map->end()) {
-        osmium::unsigned_object_id_type way_id = build_way(feat, ogr_ls, &node_ref_map);
-        g_way_offset_map.set(way_id, g_way_buffer.commit());
+    if (index_z_lvl_range.empty()) {
+        build_way(feat, line, &node_ref_map);
+        g_way_buffer.commit();
     } else {
-        index_z_lvl_vector_type& index_z_lvl_vector = it->second;
-
         // way with different z_levels
-        auto first_point_with_different_z_lvl = index_z_lvl_vector.at(0);
-        auto first_index = 0;
-        z_lvl_type first_z_lvl;
-        if (first_point_with_different_z_lvl.first == first_index) first_z_lvl =
-                first_point_with_different_z_lvl.second;
-        else first_z_lvl = 0;
-        process_first_end_point(first_index, first_z_lvl, ogr_ls, z_level_map, node_ref_map);
-
-        auto last_point_with_different_z_lvl = index_z_lvl_vector.at(index_z_lvl_vector.size() - 1);
-        auto last_index = ogr_ls->getNumPoints() - 1;
-        z_lvl_type last_z_lvl;
-        if (last_point_with_different_z_lvl.first == last_index) last_z_lvl = last_point_with_different_z_lvl.second;
-        else last_z_lvl = 0;
-        process_last_end_point(last_index, last_z_lvl, ogr_ls, z_level_map, node_ref_map);
-
-        g_way_buffer.commit();
-
-        bool ferry = is_ferry(get_field_from_feature(feat, FERRY));
-        if (ferry) set_ferry_z_lvls_to_zero(feat, index_z_lvl_vector);
-
-        split_way_by_z_level(feat, ogr_ls, index_z_lvl_vector, &node_ref_map, link_id);
+        process_end_point(true, get_first_z_lvl(index_z_lvl_range), line, node_ref_map);
+        process_end_point(false, get_last_z_lvl(index_z_lvl_range, line.size() - 1), line, node_ref_map);
+
+        bool ferry = is_ferry(get_field_from_feature(feat, SF_FERRY));
+        if (ferry) {
+            // copy, z-levels of z_level_map are shared between threads
+            index_z_lvl_vector_type index_z_lvl_vector(index_z_lvl_range.begin(), index_z_lvl_range.end());
+            set_ferry_z_lvls_to_zero(line, index_z_lvl_vector);
+            split_way_by_z_level(feat, line, index_z_lvl_vector, &node_ref_map, link_id);
+        } else {
+            split_way_by_z_level(feat, line, index_z_lvl_range, &node_ref_map, link_id);
+        }
     }
 
-    if (!strcmp(get_field_from_feature(feat, ADDR_TYPE), "B")) {
-        create_house_numbers(feat, ogr_ls);
+    if (!strcmp(get_field_from_feature(feat, SF_ADDR_TYPE), "B")) {
+        create_house_numbers(feat, line);
     }
-    // ogr_ls will be cleaned alongside with feat
-    ogr_ls.release();
+}
+
+/**
+ * \brief creates Way from linestring.
+ * \param z_lvls provides z_levels to Nodes of Ways.
+ */
+void process_way(ogr_feature_uptr& feat, const polyline_span& line, z_lvl_reader& z_lvls) {
+    process_way(feat, line, z_lvls.find(get_uint_from_feature(feat, SF_LINK_ID)));
 }
 
 // \brief writes way end node to way_end_points_map.
 void process_way_end_node(osmium::Location location) {
-    init_map_at_element(&g_way_end_points_map, location, get_node(location));
+    if (!g_way_end_points_map.find(location)) g_way_end_points_map.insert(location, build_node(location));
 }
 
 // \brief gets end nodes of linestring and processes them.
-void process_way_end_nodes(OGRLineString *ogr_ls) {
-    process_way_end_node(osmium::Location(ogr_ls->getX(0), ogr_ls->getY(0)));
-    process_way_end_node(
-            osmium::Location(ogr_ls->getX(ogr_ls->getNumPoints() - 1), ogr_ls->getY(ogr_ls->getNumPoints() - 1)));
+void process_way_end_nodes(const polyline_span& line) {
+    process_way_end_node(line.location(0));
+    process_way_end_node(line.location(line.size() - 1));
+}
+
+// \brief creates end nodes of linestring with z-levels.
+void process_z_lvl_end_nodes(const polyline_span& line, const z_lvl_range& index_z_lvl_vector) {
+    create_z_lvl_end_point(true, get_first_z_lvl(index_z_lvl_vector), line);
+    create_z_lvl_end_point(false, get_last_z_lvl(index_z_lvl_vector, line.size() - 1), line);
 }
 
 /**
@@ -672,9 +852,7 @@ node_vector_type create_admin_boundary_way_nodes(OGRLinearRing* ring) {
  * \brief creates ways for administrative boundary
  * \return osm_ids of created ways
  */
-osm_id_vector_type build_admin_boundary_ways(OGRLinearRing* ring) {
-    node_vector_type osm_way_node_ids = create_admin_boundary_way_nodes(ring);
-
+osm_id_vector_type build_admin_boundary_ways(const node_vector_type& osm_way_node_ids) {
     osm_id_vector_type osm_way_ids;
     int i = 0;
     do {
@@ -691,6 +869,10 @@ osm_id_vector_type build_admin_boundary_ways(OGRLinearRing* ring) {
     return osm_way_ids;
 }
 
+osm_id_vector_type build_admin_boundary_ways(OGRLinearRing* ring) {
+    return build_admin_boundary_ways(create_admin_boundary_way_nodes(ring));
+}
+
 /**
  * \brief adds navteq administrative boundary tags to Relation
  */
@@ -811,12 +993,16 @@ void process_admin_boundary(ogr_layer_uptr& layer, ogr_feature_uptr& feat) {
  * \param handle file handle to navteq administrative meta data.
  */
 void process_meta_areas(boost::filesystem::path dir) {
-    DBFHandle handle = read_dbf_file(dir / MTD_AREA_DBF);
+    mmap_dbf_reader dbf(dir / MTD_AREA_DBF);
+    count_rows(dbf.record_count());
+    const int area_id_field = dbf_get_field_index(dbf, AREA_ID);
+    const int admin_lvl_field = dbf_get_field_index(dbf, ADMIN_LVL);
+    const int lang_code_field = dbf_get_field_index(dbf, LANG_CODE);
+    const int area_name_field = dbf_get_field_index(dbf, AREA_NAME);
 
-    link_id_type last_link_id;
-    for (int i = 0; i < DBFGetRecordCount(handle); i++) {
+    for (int i = 0; i < dbf.record_count(); i++) {
 
-        osmium::unsigned_object_id_type area_id = dbf_get_uint_by_field(handle, i, AREA_ID);
+        osmium::unsigned_object_id_type area_id = dbf.get_int(i, area_id_field);
 
         mtd_area_dataset data;
         if (g_mtd_area_map.find(area_id) != g_mtd_area_map.end()) {
@@ -824,7 +1010,7 @@ void process_meta_areas(boost::filesystem::path dir) {
         }
         data.area_id = area_id;
 
-        std::string admin_lvl = std::to_string(dbf_get_uint_by_field(handle, i, ADMIN_LVL));
+        std::string admin_lvl = std::to_string(dbf.get_int(i, admin_lvl_field));
 
         if (data.admin_lvl.empty()) {
             data.admin_lvl = admin_lvl;
@@ -833,30 +1019,34 @@ void process_meta_areas(boost::filesystem::path dir) {
                     << admin_lvl << std::endl;
         }
 
-        std::string lang_code = dbf_get_string_by_field(handle, i, LANG_CODE);
-        std::string area_name = dbf_get_string_by_field(handle, i, AREA_NAME);
+        std::string lang_code = dbf.get_string(i, lang_code_field);
+        std::string area_name = dbf.get_string(i, area_name_field);
         data.lang_code_2_area_name.push_back(std::make_pair(lang_code, to_camel_case_with_spaces(area_name)));
 
         g_mtd_area_map.insert(std::make_pair(area_id, data));
     }
-    DBFClose(handle);
 }
 
-link_id_vector_type collect_via_manoeuvre_link_ids(link_id_type link_id, DBFHandle rdms_handle,
-        cond_id_type cond_id, int& i) {
+/**
+ * \brief collects the links of the manoeuvre of cond_id starting at row i and moves i to its last row.
+ * \param cond_id_field index of COND_ID in rdms_dbf.
+ * \param man_link_id_field index of MAN_LINKID in rdms_dbf.
+ */
+link_id_vector_type collect_via_manoeuvre_link_ids(link_id_type link_id, const mmap_dbf_reader& rdms_dbf,
+        cond_id_type cond_id, int& i, int cond_id_field, int man_link_id_field) {
     link_id_vector_type via_manoeuvre_link_id;
     via_manoeuvre_link_id.push_back(link_id);
     for (int j = 0;; j++) {
-        if (i + j == DBFGetRecordCount(rdms_handle)) {
+        if (i + j == rdms_dbf.record_count()) {
             i += j - 1;
             break;
         }
-        cond_id_type next_cond_id = dbf_get_uint_by_field(rdms_handle, i + j, COND_ID);
+        cond_id_type next_cond_id = rdms_dbf.get_int(i + j, cond_id_field);
         if (cond_id != next_cond_id) {
             i += j - 1;
             break;
         }
-        via_manoeuvre_link_id.push_back(dbf_get_uint_by_field(rdms_handle, i + j, MAN_LINKID));
+        via_manoeuvre_link_id.push_back(rdms_dbf.get_int(i + j, man_link_id_field));
     }
     return via_manoeuvre_link_id;
 }
@@ -872,15 +1062,11 @@ osm_id_vector_type collect_via_manoeuvre_osm_ids(const link_id_vector_type& via_
     for (auto it : via_manoeuvre_link_id) {
         bool reverse = false;
 
-        if (g_link_id_map.find(it) == g_link_id_map.end()) return osm_id_vector_type();
+        const link_ways_type* link = find_link_ways(it);
+        if (!link) return osm_id_vector_type();
 
-        osm_id_vector_type &osm_id_vector = g_link_id_map.at(it);
-        auto first_osm_id = osm_id_vector.at(0);
-        const auto &first_way = g_way_buffer.get<const osmium::Way>(g_way_offset_map.get(first_osm_id));
-        osmium::Location first_way_front = first_way.nodes().front().location();
-        auto last_osm_id = osm_id_vector.at(osm_id_vector.size() - 1);
-        const auto &last_way = g_way_buffer.get<const osmium::Way>(g_way_offset_map.get(last_osm_id));
-        osmium::Location last_way_back = last_way.nodes().back().location();
+        osmium::Location first_way_front = link->front.location();
+        osmium::Location last_way_back = link->back.location();
 
         // determine end_points
         if (ctr == 0) {
@@ -906,51 +1092,43 @@ osm_id_vector_type collect_via_manoeuvre_osm_ids(const link_id_vector_type& via_
         }
 
         // check wether we have to reverse vector
-        if (osm_id_vector.size() > 1) {
+        if (link->first_way_id != link->last_way_id) {
             if (end_point_back == first_way_front) reverse = true;
             else
             assert(end_point_back == last_way_back);
         }
-        if (reverse) via_manoeuvre_osm_id.insert(via_manoeuvre_osm_id.end(), osm_id_vector.rbegin(),
-                osm_id_vector.rend());
-        else via_manoeuvre_osm_id.insert(via_manoeuvre_osm_id.end(), osm_id_vector.begin(), osm_id_vector.end());
+        size_t way_count = link->last_way_id - link->first_way_id + 1;
+        for (size_t i = 0; i < way_count; i++)
+            via_manoeuvre_osm_id.push_back(reverse ? link->last_way_id - i : link->first_way_id + i);
 
         ctr++;
     } // end link_id loop
     return via_manoeuvre_osm_id;
 }
 
-void init_cdms_map(DBFHandle cdms_handle, std::map<osmium::unsigned_object_id_type, ushort>& cdms_map) {
-    for (int i = 0; i < DBFGetRecordCount(cdms_handle); i++) {
-        osmium::unsigned_object_id_type cond_id = dbf_get_uint_by_field(cdms_handle, i, COND_ID);
-        ushort cond_type = dbf_get_uint_by_field(cdms_handle, i, COND_TYPE);
-        cdms_map.insert(std::make_pair(cond_id, cond_type));
-    }
-}
-
 /**
  * \brief reads turn restrictions from DBF file and writes them to osmium.
+ *        Types of conditions are taken from g_cdms_map, which is loaded by add_street_shapes().
  * \param handle DBF file handle to navteq manoeuvres.
  * */
 
 void add_turn_restrictions(path_vector_type dirs) {
-    // maps COND_ID to COND_TYPE
-    std::map<osmium::unsigned_object_id_type, ushort> cdms_map;
-    for (auto dir : dirs)
-        init_cdms_map(read_dbf_file(dir / CDMS_DBF), cdms_map);
-
     for (auto dir : dirs) {
-        DBFHandle rdms_handle = read_dbf_file(dir / RDMS_DBF);
-        for (int i = 0; i < DBFGetRecordCount(rdms_handle); i++) {
+        mmap_dbf_reader rdms_dbf(dir / RDMS_DBF);
+        const int link_id_field = dbf_get_field_index(rdms_dbf, LINK_ID);
+        const int cond_id_field = dbf_get_field_index(rdms_dbf, COND_ID);
+        const int man_link_id_field = dbf_get_field_index(rdms_dbf, MAN_LINKID);
+        count_rows(rdms_dbf.record_count());
+        for (int i = 0; i < rdms_dbf.record_count(); i++) {
 
-            link_id_type link_id = dbf_get_uint_by_field(rdms_handle, i, LINK_ID);
-            cond_id_type cond_id = dbf_get_uint_by_field(rdms_handle, i, COND_ID);
+            link_id_type link_id = rdms_dbf.get_int(i, link_id_field);
+            cond_id_type cond_id = rdms_dbf.get_int(i, cond_id_field);
 
-            auto it = cdms_map.find(cond_id);
-            if (it != cdms_map.end() && it->second != RESTRICTED_DRIVING_MANOEUVRE) continue;
+            const cond_type_type* cond_type = g_cdms_map.find_cond_type(cond_id);
+            if (cond_type && *cond_type != RESTRICTED_DRIVING_MANOEUVRE) continue;
 
-            link_id_vector_type via_manoeuvre_link_id = collect_via_manoeuvre_link_ids(link_id, rdms_handle, cond_id,
-                    i);
+            link_id_vector_type via_manoeuvre_link_id = collect_via_manoeuvre_link_ids(link_id, rdms_dbf, cond_id,
+                    i, cond_id_field, man_link_id_field);
 
             osm_id_vector_type via_manoeuvre_osm_id = collect_via_manoeuvre_osm_ids(via_manoeuvre_link_id);
 
@@ -958,148 +1136,591 @@ void add_turn_restrictions(path_vector_type dirs) {
             if (via_manoeuvre_osm_id.empty()) continue;
 
             // todo find out which direction turn restriction has and apply. For now: always apply 'no_straight_on'
-            build_turn_restriction(via_manoeuvre_osm_id);
+            build_turn_restriction(via_manoeuvre_osm_id, via_manoeuvre_link_id);
+            flush_rel_buffer();
         }
     }
 }
 
 void init_g_cnd_mod_map(const boost::filesystem::path& dir, std::ostream& out) {
-    DBFHandle cnd_mod_handle = read_dbf_file(dir / CND_MOD_DBF, out);
-    for (int i = 0; i < DBFGetRecordCount(cnd_mod_handle); i++) {
-        cond_id_type cond_id = dbf_get_uint_by_field(cnd_mod_handle, i, COND_ID);
-        // std::string lang_code = dbf_get_string_by_field(cnd_mod_handle, i, LANG_CODE);
-        mod_typ_type mod_type = dbf_get_uint_by_field(cnd_mod_handle, i, CM_MOD_TYPE);
-        mod_val_type mod_val = dbf_get_uint_by_field(cnd_mod_handle, i, CM_MOD_VAL);
-        g_cnd_mod_map.insert(std::make_pair(cond_id, mod_group_type(mod_type, mod_val)));
+    mmap_dbf_reader cnd_mod_dbf(dir / CND_MOD_DBF, out);
+    count_rows(cnd_mod_dbf.record_count());
+    const int cond_id_field = dbf_get_field_index(cnd_mod_dbf, COND_ID);
+    const int mod_type_field = dbf_get_field_index(cnd_mod_dbf, CM_MOD_TYPE);
+    const int mod_val_field = dbf_get_field_index(cnd_mod_dbf, CM_MOD_VAL);
+    for (int i = 0; i < cnd_mod_dbf.record_count(); i++) {
+        cond_id_type cond_id = cnd_mod_dbf.get_int(i, cond_id_field);
+        // std::string lang_code = dbf_get_string_by_field(cnd_mod_dbf, i, LANG_CODE);
+        mod_typ_type mod_type = cnd_mod_dbf.get_int(i, mod_type_field);
+        mod_val_type mod_val = cnd_mod_dbf.get_int(i, mod_val_field);
+        if (restriction_of_mod_type(mod_type) == link_restrictions_type::restriction_count) continue;
+        g_cnd_mod_rows.push_back(std::make_pair(cond_id, mod_group_type(mod_type, mod_val)));
     }
-    DBFClose(cnd_mod_handle);
+}
+
+/**
+ * \brief joins the conditions of links (g_cdms_map) with the restrictions of conditions (g_cnd_mod_rows)
+ *        and stores the smallest restrictions of each link in g_link_restrictions.
+ *        Both sides are sorted by condition id and merged, so parsing the tags of a street only
+ *        needs a single lookup. g_cnd_mod_rows isn't needed afterwards and is released.
+ */
+void init_link_restrictions() {
+    std::vector<std::pair<cond_id_type, link_id_type>> cond_links;
+    g_cdms_map.for_each_condition([&cond_links](link_id_type link_id, cond_id_type cond_id) {
+        cond_links.push_back(std::make_pair(cond_id, link_id));
+    });
+    std::sort(cond_links.begin(), cond_links.end());
+    std::stable_sort(g_cnd_mod_rows.begin(), g_cnd_mod_rows.end(),
+            [](const cnd_mod_vector_type::value_type& lhs, const cnd_mod_vector_type::value_type& rhs) {
+                return lhs.first < rhs.first;
+            });
+
+    // [link_id, [restriction, value]] of all joined rows
+    std::vector<std::pair<link_id_type, std::pair<link_restrictions_type::restriction, mod_val_type>>> link_mods;
+    auto cond_link = cond_links.cbegin();
+    auto cnd_mod = g_cnd_mod_rows.cbegin();
+    while (cond_link != cond_links.cend() && cnd_mod != g_cnd_mod_rows.cend()) {
+        if (cond_link->first < cnd_mod->first) {
+            ++cond_link;
+        } else if (cnd_mod->first < cond_link->first) {
+            ++cnd_mod;
+        } else {
+            // all modifications of a condition apply to all of its links
+            auto cnd_mod_end = cnd_mod;
+            while (cnd_mod_end != g_cnd_mod_rows.cend() && cnd_mod_end->first == cnd_mod->first)
+                ++cnd_mod_end;
+            for (; cond_link != cond_links.cend() && cond_link->first == cnd_mod->first; ++cond_link) {
+                for (auto it = cnd_mod; it != cnd_mod_end; ++it)
+                    link_mods.push_back(std::make_pair(cond_link->second,
+                            std::make_pair(restriction_of_mod_type(it->second.mod_type), it->second.mod_val)));
+            }
+            cnd_mod = cnd_mod_end;
+        }
+    }
+
+    std::sort(link_mods.begin(), link_mods.end());
+    g_link_restrictions.clear();
+    for (auto& link_mod : link_mods)
+        g_link_restrictions.add(link_mod.first, link_mod.second.first, link_mod.second.second);
+    cnd_mod_vector_type().swap(g_cnd_mod_rows);
 }
 
 void init_g_cdms_map(const boost::filesystem::path& dir, std::ostream& out) {
-    DBFHandle cdms_handle = read_dbf_file(dir / CDMS_DBF, out);
-    for (int i = 0; i < DBFGetRecordCount(cdms_handle); i++) {
-        link_id_type link_id = dbf_get_uint_by_field(cdms_handle, i, LINK_ID);
-        cond_id_type cond_id = dbf_get_uint_by_field(cdms_handle, i, COND_ID);
-        g_cdms_map.insert(std::make_pair(link_id, cond_id));
+    mmap_dbf_reader cdms_dbf(dir / CDMS_DBF, out);
+    count_rows(cdms_dbf.record_count());
+    const int link_id_field = dbf_get_field_index(cdms_dbf, LINK_ID);
+    const int cond_id_field = dbf_get_field_index(cdms_dbf, COND_ID);
+    const int cond_type_field = dbf_get_field_index(cdms_dbf, COND_TYPE);
+    for (int i = 0; i < cdms_dbf.record_count(); i++) {
+        link_id_type link_id = cdms_dbf.get_int(i, link_id_field);
+        cond_id_type cond_id = cdms_dbf.get_int(i, cond_id_field);
+        cond_type_type cond_type = cdms_dbf.get_int(i, cond_type_field);
+        g_cdms_map.add(link_id, cond_id, cond_type);
     }
-    DBFClose(cdms_handle);
 }
 
 void init_g_area_to_govt_code_map(const boost::filesystem::path& dir, std::ostream& out) {
-    DBFHandle mtd_area_handle = read_dbf_file(dir / MTD_AREA_DBF, out);
-    for (int i = 0; i < DBFGetRecordCount(mtd_area_handle); i++) {
-        area_id_type area_id = dbf_get_uint_by_field(mtd_area_handle, i, AREA_ID);
-        govt_code_type govt_code = dbf_get_uint_by_field(mtd_area_handle, i, GOVT_CODE);
+    mmap_dbf_reader mtd_area_dbf(dir / MTD_AREA_DBF, out);
+    count_rows(mtd_area_dbf.record_count());
+    const int area_id_field = dbf_get_field_index(mtd_area_dbf, AREA_ID);
+    const int govt_code_field = dbf_get_field_index(mtd_area_dbf, GOVT_CODE);
+    for (int i = 0; i < mtd_area_dbf.record_count(); i++) {
+        area_id_type area_id = mtd_area_dbf.get_int(i, area_id_field);
+        govt_code_type govt_code = mtd_area_dbf.get_int(i, govt_code_field);
         g_area_to_govt_code_map.insert(std::make_pair(area_id, govt_code));
     }
-    DBFClose(mtd_area_handle);
 }
 
 void init_g_cntry_ref_map(const boost::filesystem::path& dir, std::ostream& out) {
-    DBFHandle cntry_ref_handle = read_dbf_file(dir / MTD_CNTRY_REF_DBF, out);
-    for (int i = 0; i < DBFGetRecordCount(cntry_ref_handle); i++) {
-        govt_code_type govt_code = dbf_get_uint_by_field(cntry_ref_handle, i, GOVT_CODE);
-        auto unit_measure = dbf_get_string_by_field(cntry_ref_handle, i, UNTMEASURE);
-        auto speed_limit_unit = dbf_get_string_by_field(cntry_ref_handle, i, SPEEDLIMITUNIT);
-        auto iso_code = dbf_get_string_by_field(cntry_ref_handle, i, ISO_CODE);
+    mmap_dbf_reader cntry_ref_dbf(dir / MTD_CNTRY_REF_DBF, out);
+    count_rows(cntry_ref_dbf.record_count());
+    const int govt_code_field = dbf_get_field_index(cntry_ref_dbf, GOVT_CODE);
+    const int unit_measure_field = dbf_get_field_index(cntry_ref_dbf, UNTMEASURE);
+    const int speed_limit_unit_field = dbf_get_field_index(cntry_ref_dbf, SPEEDLIMITUNIT);
+    const int iso_code_field = dbf_get_field_index(cntry_ref_dbf, ISO_CODE);
+    for (int i = 0; i < cntry_ref_dbf.record_count(); i++) {
+        govt_code_type govt_code = cntry_ref_dbf.get_int(i, govt_code_field);
+        auto unit_measure = cntry_ref_dbf.get_string(i, unit_measure_field);
+        auto speed_limit_unit = cntry_ref_dbf.get_string(i, speed_limit_unit_field);
+        auto iso_code = cntry_ref_dbf.get_string(i, iso_code_field);
         auto cntry_ref = cntry_ref_type(unit_measure.c_str()[0], speed_limit_unit.c_str(), iso_code.c_str());
         g_cntry_ref_map.insert(std::make_pair(govt_code, cntry_ref));
     }
-    DBFClose(cntry_ref_handle);
 }
 
 ogr_layer_uptr_vector init_street_layers(const path_vector_type& dirs, std::ostream& out) {
     ogr_layer_uptr_vector layer_vector;
     for (auto dir : dirs) {
         layer_vector.push_back(ogr_layer_uptr(read_shape_file(dir / STREETS_SHP, out)));
+        // fail early if a column is missing
+        bind_streets_layer(layer_vector.back().get());
     }
     return layer_vector;
 }
 
 // \brief stores z_levels in z_level_map for later use. Maps link_ids to pairs of indices and z-levels of waypoints with z-levels not equal 0.
-void init_z_level_map(boost::filesystem::path dir, std::ostream& out, z_lvl_map& z_level_map) {
-    DBFHandle handle = read_dbf_file(dir / ZLEVELS_DBF, out);
+void init_z_level_map(boost::filesystem::path dir, std::ostream& out, z_lvl_index& z_level_map) {
+    mmap_dbf_reader dbf(dir / ZLEVELS_DBF, out);
+    count_rows(dbf.record_count());
+
+    const int link_id_field = dbf_get_field_index(dbf, LINK_ID);
+    const int point_num_field = dbf_get_field_index(dbf, POINT_NUM);
+    const int z_level_field = dbf_get_field_index(dbf, Z_LEVEL);
 
     link_id_type last_link_id;
+    // z-levels of the current link, reused for all links
     index_z_lvl_vector_type v;
 
-    for (int i = 0; i < DBFGetRecordCount(handle); i++) {
-        link_id_type link_id = dbf_get_uint_by_field(handle, i, LINK_ID);
-        ushort point_num = dbf_get_uint_by_field(handle, i, POINT_NUM) - 1;
+    for (int i = 0; i < dbf.record_count(); i++) {
+        link_id_type link_id = dbf.get_int(i, link_id_field);
+        ushort point_num = dbf.get_int(i, point_num_field) - 1;
         assert(point_num >= 0);
-        short z_level = dbf_get_uint_by_field(handle, i, Z_LEVEL);
+        short z_level = dbf.get_int(i, z_level_field);
 
         if (i > 0 && last_link_id != link_id && v.size() > 0) {
-            z_level_map.insert(std::make_pair(last_link_id, v));
-            v = index_z_lvl_vector_type();
+            z_level_map.add(last_link_id, v);
+            v.clear();
         }
         if (z_level != 0) v.push_back(std::make_pair(point_num, z_level));
         last_link_id = link_id;
     }
 
-    if (!v.empty()) z_level_map.insert(std::make_pair(last_link_id, v));
+    if (!v.empty()) z_level_map.add(last_link_id, v);
 }
 
-void init_conditional_driving_manoeuvres(const boost::filesystem::path& dir, std::ostream& out) {
-    if (dbf_file_exists(dir / CND_MOD_DBF) && dbf_file_exists(dir / CDMS_DBF)) {
-        init_g_cnd_mod_map(dir, out);
-        init_g_cdms_map(dir, out);
-    }
+// \brief checks whether the rows of dbf_file are ordered by LINK_ID.
+bool dbf_ordered_by_link_id(const boost::filesystem::path& dbf_file) {
+    mmap_dbf_reader dbf(dbf_file, cnull);
+    const int link_id_field = dbf_get_field_index(dbf, LINK_ID);
+    for (int i = 1; i < dbf.record_count(); i++)
+        if (dbf.get_int(i, link_id_field) < dbf.get_int(i - 1, link_id_field)) return false;
+    return true;
 }
 
-void init_country_reference(const boost::filesystem::path& dir, std::ostream& out) {
-    if (dbf_file_exists(dir / MTD_AREA_DBF) && dbf_file_exists(dir / MTD_CNTRY_REF_DBF)) {
-        init_g_area_to_govt_code_map(dir, out);
-        init_g_cntry_ref_map(dir, out);
+/**
+ * \brief checks whether z-levels of all dirs can be merge joined with Streets by z_lvl_reader.
+ */
+bool z_levels_ordered(const path_vector_type& dirs, std::ostream& out) {
+    for (auto& dir : dirs) {
+        if (!dbf_ordered_by_link_id(dir / STREETS_DBF) || !dbf_ordered_by_link_id(dir / ZLEVELS_DBF)) {
+            out << " Streets or Zlevels of " << dir << " aren't ordered by LINK_ID, z-levels are indexed" << std::endl;
+            return false;
+        }
     }
+    return true;
 }
 
-z_lvl_map process_z_levels(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector, std::ostream& out) {
+z_lvl_index process_z_levels(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector, std::ostream& out) {
     assert(layer_vector.size() == dirs.size());
-    z_lvl_map z_level_map;
+    z_lvl_index z_level_map;
     for (int i = 0; i < layer_vector.size(); i++) {
         boost::filesystem::path dir = dirs.at(i);
         auto& layer = layer_vector.at(i);
         assert(layer->GetGeomType() == wkbLineString);
 
         init_z_level_map(dir, out, z_level_map);
-        init_conditional_driving_manoeuvres(dir, out);
-        init_country_reference(dir, out);
     }
+    z_level_map.sort();
     return z_level_map;
 }
 
-void process_way_end_nodes(ogr_layer_uptr_vector& layer_vector, z_lvl_map& z_level_map) {
+bool has_country_reference(const boost::filesystem::path& dir) {
+    return dbf_file_exists(dir / MTD_AREA_DBF) && dbf_file_exists(dir / MTD_CNTRY_REF_DBF);
+}
+
+/**
+ * \brief loads the tables of all dirs which streets and administrative boundaries look up across
+ *        directories: countries of areas (MtdArea.dbf, MtdCntryRef.dbf) and admin levels and names of
+ *        areas. Loading a directory again later doesn't change them, as the first row of an area wins.
+ */
+void init_shared_reference_tables(const path_vector_type& dirs) {
+    for (auto& dir : dirs) {
+        if (has_country_reference(dir)) {
+            init_g_area_to_govt_code_map(dir, cnull);
+            init_g_cntry_ref_map(dir, cnull);
+        }
+        if (dbf_file_exists(dir / MTD_AREA_DBF)) process_meta_areas(dir);
+    }
+}
+
+/**
+ * \brief loads the z-levels into z_level_map (unless nullptr) and the reference tables of conditional
+ *        driving manoeuvres and countries of all dirs.
+ *        The tables are independent and loaded concurrently, each into its own structure, the
+ *        link restrictions are joined when CndMod.dbf and Cdms.dbf are loaded. Up to threads tables are
+ *        loaded at once, their times are written to out.
+ */
+void process_reference_tables(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector,
+        z_lvl_index* z_level_map, std::ostream& out, unsigned int threads = 1) {
+    task_graph graph;
+    if (z_level_map) graph.add("Zlevels", [&] {
+        *z_level_map = process_z_levels(dirs, layer_vector, cnull);
+    });
+    // conditional modifications are only used together with Cdms.dbf
+    auto cnd_mod = graph.add("CndMod", [&] {
+        for (auto& dir : dirs)
+            if (dbf_file_exists(dir / CDMS_DBF) && dbf_file_exists(dir / CND_MOD_DBF)) init_g_cnd_mod_map(dir, cnull);
+    });
+    // g_cdms_map is needed for turn restrictions even without conditional modifications
+    auto cdms = graph.add("Cdms", [&] {
+        for (auto& dir : dirs)
+            if (dbf_file_exists(dir / CDMS_DBF)) init_g_cdms_map(dir, cnull);
+        g_cdms_map.sort();
+    });
+    graph.add("MtdArea", [&] {
+        for (auto& dir : dirs)
+            if (has_country_reference(dir)) init_g_area_to_govt_code_map(dir, cnull);
+    });
+    graph.add("MtdCntryRef", [&] {
+        for (auto& dir : dirs)
+            if (has_country_reference(dir)) init_g_cntry_ref_map(dir, cnull);
+    });
+    graph.add("link restrictions", init_link_restrictions, { cnd_mod, cdms });
+
+    graph.run(threads);
+    graph.write_timing(out);
+}
+
+/**
+ * \brief creates the end nodes of all Streets features.
+ * \param z_level_map z-levels of links or nullptr to merge join them from Zlevels.dbf.
+ */
+void process_way_end_nodes(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector,
+        const z_lvl_index* z_level_map) {
+    assert(layer_vector.size() == dirs.size());
     for (int i = 0; i < layer_vector.size(); i++) {
         auto& layer = layer_vector.at(i);
+        bind_streets_layer(layer.get());
+        shp_polyline_reader shp(dirs.at(i) / STREETS_SHP);
+        z_lvl_reader z_lvls(z_level_map, dirs.at(i));
         // get all nodes which may be a routable crossing
 
-        int feature_count = layer->GetFeatureCount(false);
-        assert(feature_count >= 0);
-        for (auto j = 0; j < feature_count; j++) {
-            auto&& feat = ogr_feature_uptr(layer->GetFeature(j));
-            link_id_type link_id = get_uint_from_feature(feat, LINK_ID);
-            // omit way end nodes with different z-levels (they have to be handled extra)
-            if (z_level_map.find(link_id) == z_level_map.end())
-                process_way_end_nodes(static_cast<OGRLineString*>(feat->GetGeometryRef()));
+        ogr_feature_cursor cursor(layer.get(), STREETS_FIELDS, STREETS_FIELD_COUNT, true);
+        while (cursor.next()) {
+            auto& feat = cursor.feature();
+            link_id_type link_id = get_uint_from_feature(feat, SF_LINK_ID);
+            // way end nodes with different z-levels have to be handled extra
+            z_lvl_range index_z_lvl_range = z_lvls.find(link_id);
+            if (index_z_lvl_range.empty()) process_way_end_nodes(shp.read(feat->GetFID()));
+            else process_z_lvl_end_nodes(shp.read(feat->GetFID()), index_z_lvl_range);
+            g_node_buffer.commit();
+            flush_node_buffer();
         }
         g_node_buffer.commit();
         g_way_buffer.commit();
-        layer->ResetReading();
     }
 }
 
-void process_way(ogr_layer_uptr_vector& layer_vector, z_lvl_map& z_level_map) {
-    for (int i = 0; i < layer_vector.size(); i++) {
+/**
+ * \brief processes the Streets features [first_feature, end_feature) of all layers.
+ *        Features are counted over all layers in the order of dirs.
+ * \param z_level_map z-levels of links or nullptr to merge join them from Zlevels.dbf.
+ */
+void process_way_range(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector,
+        const z_lvl_index* z_level_map, size_t first_feature, size_t end_feature) {
+    assert(layer_vector.size() == dirs.size());
+    size_t layer_begin = 0;
+    for (int i = 0; i < layer_vector.size() && layer_begin < end_feature; i++) {
         auto& layer = layer_vector.at(i);
-        int feature_count = layer->GetFeatureCount(false);
-        assert(feature_count >= 0);
-        for (auto j = 0; j < feature_count; j++) {
-            process_way(ogr_feature_uptr(layer->GetFeature(j)), &z_level_map);
+        shp_polyline_reader shp(dirs.at(i) / STREETS_SHP);
+        size_t layer_end = layer_begin + shp.record_count();
+        if (layer_end > first_feature) {
+            // feature ids of shapefiles are record numbers
+            GIntBig first_fid = first_feature > layer_begin ? first_feature - layer_begin : 0;
+            GIntBig end_fid = std::min(end_feature, layer_end) - layer_begin;
+
+            bind_streets_layer(layer.get());
+            z_lvl_reader z_lvls(z_level_map, dirs.at(i));
+            ogr_feature_cursor cursor(layer.get(), STREETS_FIELDS, STREETS_FIELD_COUNT, true);
+            cursor.seek(first_fid);
+            while (cursor.next() && cursor.feature()->GetFID() < end_fid) {
+                auto& feat = cursor.feature();
+                process_way(feat, shp.read(feat->GetFID()), z_lvls);
+                flush_node_buffer();
+                flush_way_buffer();
+            }
         }
+        layer_begin = layer_end;
     }
 }
 
+size_t count_street_features(const path_vector_type& dirs) {
+    size_t feature_count = 0;
+    for (auto& dir : dirs)
+        feature_count += shp_polyline_reader(dir / STREETS_SHP).record_count();
+    return feature_count;
+}
+
+// first id of objects created by street workers. ids are renumbered when merging the results.
+static constexpr osmium::unsigned_object_id_type STREET_WORKER_FIRST_ID = 1ULL << 48;
+
+// number of Streets features the reader passes to the street workers at once
+static constexpr size_t STREET_BATCH_SIZE = 1024;
+// initial size of the buffers of a street worker per batch, they grow if needed
+static constexpr size_t STREET_BATCH_BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * \brief Streets features together with their geometries and z-levels, read by the reader stage of
+ *        the street pipeline. Street workers need neither OGR layers nor Zlevels.dbf.
+ */
+struct street_batch {
+    // position of the batch in the order of the features
+    size_t sequence;
+    // definition of the layer of all features of the batch
+    OGRFeatureDefn* defn;
+    std::vector<ogr_feature_uptr> features;
+    // coordinates of feature i are xy[2 * first_points[i], 2 * first_points[i + 1])
+    std::vector<double> xy;
+    std::vector<size_t> first_points;
+    // z-levels of feature i are z_lvls[first_z_lvls[i], first_z_lvls[i + 1])
+    index_z_lvl_vector_type z_lvls;
+    std::vector<size_t> first_z_lvls;
+
+    street_batch(size_t sequence, OGRFeatureDefn* defn) :
+            sequence(sequence), defn(defn), first_points(1, 0), first_z_lvls(1, 0) {
+        features.reserve(STREET_BATCH_SIZE);
+    }
+
+    size_t size() const {
+        return features.size();
+    }
+
+    void add(ogr_feature_uptr&& feat, const polyline_span& line, const z_lvl_range& link_z_lvls) {
+        features.push_back(std::move(feat));
+        xy.insert(xy.end(), line.data(), line.data() + 2 * line.size());
+        first_points.push_back(xy.size() / 2);
+        z_lvls.insert(z_lvls.end(), link_z_lvls.begin(), link_z_lvls.end());
+        first_z_lvls.push_back(z_lvls.size());
+    }
+
+    polyline_span line(size_t i) const {
+        return polyline_span(xy.data() + 2 * first_points.at(i), first_points.at(i + 1) - first_points.at(i));
+    }
+
+    z_lvl_range link_z_lvls(size_t i) const {
+        return z_lvl_range(z_lvls.data() + first_z_lvls.at(i), z_lvls.data() + first_z_lvls.at(i + 1));
+    }
+};
+
+/**
+ * \brief objects created by a street worker on a batch of features.
+ */
+struct street_worker_result {
+    size_t sequence = 0;
+    osmium::memory::Buffer node_buffer;
+    osmium::memory::Buffer way_buffer;
+    link_ways_vector_type link_ways;
+    osmium::unsigned_object_id_type end_osm_id = STREET_WORKER_FIRST_ID;
+    std::exception_ptr exception;
+};
+
+typedef std::unique_ptr<street_batch> street_batch_uptr;
+typedef std::unique_ptr<street_worker_result> street_worker_result_uptr;
+
+/**
+ * \brief Queues and progress shared by the stages of the street pipeline:
+ *        reader -> batches -> street workers -> results -> committer.
+ *        Batches are only read while fewer than max_batches_in_flight are uncommitted,
+ *        which bounds the memory of the pipeline, so the queues never overflow.
+ *        Stages which have to wait sleep on the monitor.
+ */
+struct street_pipeline {
+    size_t max_batches_in_flight;
+    bounded_queue<street_batch_uptr> batches;
+    bounded_queue<street_worker_result_uptr> results;
+    std::atomic<size_t> committed_batches;
+    // number of batches, known when the reader has finished
+    std::atomic<size_t> batch_count;
+    // aborted if a stage failed, the other stages stop then
+    pipeline_monitor monitor;
+    std::exception_ptr reader_exception;
+    // cursors of the reader, which restore the layers when destroyed. Workers still use features of
+    // the layer definitions after the reader has finished, so they live as long as the pipeline.
+    std::vector<std::unique_ptr<ogr_feature_cursor>> cursors;
+
+    explicit street_pipeline(size_t max_batches_in_flight) :
+            max_batches_in_flight(max_batches_in_flight), batches(max_batches_in_flight), results(
+                    max_batches_in_flight), committed_batches(0), batch_count(std::numeric_limits<size_t>::max()) {
+    }
+
+    /**
+     * \brief waits until batch sequence may be read.
+     * \return false if the pipeline has been aborted.
+     */
+    bool wait_for_batch(size_t sequence) {
+        return monitor.wait([this, sequence] {return sequence < committed_batches + max_batches_in_flight;});
+    }
+};
+
+/**
+ * \brief reader stage of the street pipeline: reads Streets features with their geometries and
+ *        z-levels in batches of STREET_BATCH_SIZE features. Finally passes one nullptr per worker.
+ *        The only stage using the OGR layers and Zlevels.dbf, which are read sequentially.
+ */
+void street_reader(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector,
+        const z_lvl_index* z_level_map, unsigned int workers, street_pipeline& pipeline) {
+    assert(layer_vector.size() == dirs.size());
+    try {
+        size_t sequence = 0;
+        for (int i = 0; i < layer_vector.size() && !pipeline.monitor.aborted(); i++) {
+            auto& layer = layer_vector.at(i);
+            bind_streets_layer(layer.get());
+            shp_polyline_reader shp(dirs.at(i) / STREETS_SHP);
+            z_lvl_reader z_lvls(z_level_map, dirs.at(i));
+            pipeline.cursors.emplace_back(
+                    new ogr_feature_cursor(layer.get(), STREETS_FIELDS, STREETS_FIELD_COUNT, true));
+            ogr_feature_cursor& cursor = *pipeline.cursors.back();
+            street_batch_uptr batch;
+            while (cursor.next()) {
+                if (!batch) {
+                    if (!pipeline.wait_for_batch(sequence)) break;
+                    batch.reset(new street_batch(sequence++, layer->GetLayerDefn()));
+                }
+                auto& feat = cursor.feature();
+                polyline_span line = shp.read(feat->GetFID());
+                z_lvl_range link_z_lvls = z_lvls.find(get_uint_from_feature(feat, SF_LINK_ID));
+                batch->add(std::move(feat), line, link_z_lvls);
+                if (batch->size() == STREET_BATCH_SIZE && !pipeline.monitor.push(pipeline.batches, batch)) break;
+            }
+            if (batch && batch->size() > 0) pipeline.monitor.push(pipeline.batches, batch);
+        }
+        pipeline.batch_count = sequence;
+        // the committer may wait for batches which don't exist
+        pipeline.monitor.notify();
+    } catch (...) {
+        pipeline.reader_exception = std::current_exception();
+        pipeline.monitor.abort();
+    }
+    for (unsigned int i = 0; i < workers; i++) {
+        street_batch_uptr end_of_input;
+        if (!pipeline.monitor.push(pipeline.batches, end_of_input)) break;
+    }
+}
+
+/**
+ * \brief worker stage of the street pipeline: processes batches until it receives nullptr.
+ *        Objects are created in the thread local buffers with ids starting at STREET_WORKER_FIRST_ID
+ *        and passed to the committer per batch. Shared maps (end points, z-levels, restrictions) are only read.
+ */
+void street_worker(street_pipeline& pipeline) {
+    street_batch_uptr batch;
+    while (pipeline.monitor.pop(pipeline.batches, batch) && batch) {
+        street_worker_result_uptr result(new street_worker_result());
+        result->sequence = batch->sequence;
+        try {
+            if (!g_streets_binding.is_bound_to(batch->defn)) bind_streets_defn(batch->defn);
+            g_osm_id = STREET_WORKER_FIRST_ID;
+            g_node_buffer = osmium::memory::Buffer(STREET_BATCH_BUFFER_SIZE);
+            g_way_buffer = osmium::memory::Buffer(STREET_BATCH_BUFFER_SIZE);
+            g_link_ways.clear();
+            for (size_t i = 0; i < batch->size(); i++)
+                process_way(batch->features.at(i), batch->line(i), batch->link_z_lvls(i));
+
+            result->node_buffer = std::move(g_node_buffer);
+            result->way_buffer = std::move(g_way_buffer);
+            result->link_ways = std::move(g_link_ways);
+            result->end_osm_id = g_osm_id;
+        } catch (...) {
+            result->exception = std::current_exception();
+        }
+        batch.reset();
+        if (!pipeline.monitor.push(pipeline.results, result)) break;
+    }
+}
+
+/**
+ * \brief appends the objects of a street worker to the global buffers.
+ *        Worker ids are replaced by consecutive ids starting at g_osm_id, so merging the batches in
+ *        order of their features yields the same ids as processing all features in one thread.
+ */
+void merge_street_worker_result(street_worker_result& result) {
+    osmium::unsigned_object_id_type first_osm_id = g_osm_id;
+    auto renumber = [first_osm_id](osmium::unsigned_object_id_type id) {
+        // ids below STREET_WORKER_FIRST_ID refer to end points which were created before
+        return id < STREET_WORKER_FIRST_ID ? id : first_osm_id + (id - STREET_WORKER_FIRST_ID);
+    };
+
+    for (auto it = result.node_buffer.begin<osmium::Node>(); it != result.node_buffer.end<osmium::Node>(); ++it)
+        it->set_id(renumber(it->id()));
+    for (auto it = result.way_buffer.begin<osmium::Way>(); it != result.way_buffer.end<osmium::Way>(); ++it) {
+        it->set_id(renumber(it->id()));
+        for (auto& node_ref : it->nodes())
+            node_ref.set_ref(renumber(node_ref.ref()));
+    }
+
+    g_node_buffer.add_buffer(result.node_buffer);
+    g_node_buffer.commit();
+    g_way_buffer.add_buffer(result.way_buffer);
+    g_way_buffer.commit();
+
+    for (auto& link : result.link_ways) {
+        link.first_way_id = renumber(link.first_way_id);
+        link.last_way_id = renumber(link.last_way_id);
+        link.front.set_ref(renumber(link.front.ref()));
+        link.back.set_ref(renumber(link.back.ref()));
+        g_link_ways.push_back(link);
+    }
+
+    g_osm_id = renumber(result.end_osm_id);
+}
+
+/**
+ * \brief creates ways of all Streets features.
+ *        With more than one thread the features are processed by a pipeline: a reader thread passes
+ *        batches of features to threads street workers, the calling thread commits their results in
+ *        the order of the batches and hands them to the writer. The output doesn't depend on the
+ *        number of threads.
+ */
+void process_way(const path_vector_type& dirs, ogr_layer_uptr_vector& layer_vector, const z_lvl_index* z_level_map,
+        unsigned int threads = 1) {
+    if (threads <= 1) {
+        process_way_range(dirs, layer_vector, z_level_map, 0, count_street_features(dirs));
+        return;
+    }
+
+    street_pipeline pipeline(4 * threads);
+    std::thread reader(street_reader, std::cref(dirs), std::ref(layer_vector), z_level_map, threads,
+            std::ref(pipeline));
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.push_back(std::thread(street_worker, std::ref(pipeline)));
+
+    // results which arrived before the results of preceding batches
+    std::map<size_t, street_worker_result_uptr> pending_results;
+    std::exception_ptr exception;
+    size_t next_sequence = 0;
+    try {
+        while (next_sequence != pipeline.batch_count) {
+            street_worker_result_uptr result;
+            bool popped = pipeline.monitor.wait([&pipeline, &result, &next_sequence] {
+                return next_sequence == pipeline.batch_count || pipeline.results.try_pop(result);
+            });
+            if (!popped) break;
+            if (!result) continue;
+            pipeline.monitor.notify();
+            if (result->exception) std::rethrow_exception(result->exception);
+            pending_results.insert(std::make_pair(result->sequence, std::move(result)));
+            for (auto it = pending_results.begin(); it != pending_results.end() && it->first == next_sequence; it =
+                    pending_results.erase(it)) {
+                merge_street_worker_result(*it->second);
+                pipeline.committed_batches = ++next_sequence;
+                pipeline.monitor.notify();
+                flush_node_buffer();
+                flush_way_buffer();
+            }
+        }
+    } catch (...) {
+        exception = std::current_exception();
+        pipeline.monitor.abort();
+    }
+
+    reader.join();
+    for (auto& worker : workers)
+        worker.join();
+    if (pipeline.reader_exception) std::rethrow_exception(pipeline.reader_exception);
+    if (exception) std::rethrow_exception(exception);
+}
+
 /****************************************************
  * adds layers to osmium:
  *      cur_layer and cur_feature have to be set
@@ -1110,31 +1731,60 @@ void process_way(ogr_layer_uptr_vector& layer_vector, z_lvl_map& z_level_map) {
  * \param layer Pointer to administrative layer.
  */
 
-void add_street_shapes(path_vector_type dirs, bool test = false) {
+/**
+ * \brief selects the storage of the node indices g_way_end_points_map and g_z_lvl_nodes_map.
+ *        Files of location_index_backend::mmap are created in dir.
+ */
+void set_node_index_backend(location_index_backend backend, const boost::filesystem::path& dir) {
+    g_way_end_points_map.set_backend(backend, dir);
+    g_z_lvl_nodes_map.set_backend(backend, dir);
+}
+
+/**
+ * \brief adds streets of all dirs.
+ * \param stream_z_levels merge join z-levels with Streets instead of indexing them, if both are ordered by LINK_ID.
+ */
+void add_street_shapes(path_vector_type dirs, bool test = false, unsigned int threads = 1, bool stream_z_levels =
+        false) {
 
     std::ostream& out = test ? cnull : std::cerr;
 
     ogr_layer_uptr_vector layer_vector = init_street_layers(dirs, out);
 
-    out << " processing z-levels" << std::endl;
-    z_lvl_map z_level_map = process_z_levels(dirs, layer_vector, out);
+    out << " processing z-levels and reference tables" << std::endl;
+    begin_phase("reference tables");
+    z_lvl_index z_level_map;
+    if (stream_z_levels) stream_z_levels = z_levels_ordered(dirs, out);
+    // without index z-levels are read along with the streets
+    z_lvl_index* z_level_index = stream_z_levels ? nullptr : &z_level_map;
+    process_reference_tables(dirs, layer_vector, z_level_index, out, threads);
+    end_phase();
+
+    size_t feature_count = count_street_features(dirs);
 
     out << " processing way end points" << std::endl;
-    process_way_end_nodes(layer_vector, z_level_map);
+    begin_phase("way end points");
+    // every link has two end points, most of them are shared with other links
+    g_way_end_points_map.reserve(g_way_end_points_map.size() + 2 * feature_count);
+    process_way_end_nodes(dirs, layer_vector, z_level_index);
+    count_rows(feature_count);
+    end_phase();
 
     out << " processing ways" << std::endl;
-    process_way(layer_vector, z_level_map);
+    begin_phase("ways");
+    process_way(dirs, layer_vector, z_level_index, threads);
+    sort_link_ways();
+    count_rows(feature_count);
+    end_phase();
 
     out << " clean" << std::endl;
-    for (auto elem : z_level_map)
-        elem.second.clear();
     z_level_map.clear();
 }
 
-void add_street_shapes(boost::filesystem::path dir, bool test = false) {
+void add_street_shapes(boost::filesystem::path dir, bool test = false, bool stream_z_levels = false) {
     path_vector_type dir_vector;
     dir_vector.push_back(dir);
-    add_street_shapes(dir_vector, test);
+    add_street_shapes(dir_vector, test, 1, stream_z_levels);
 }
 
 /**
@@ -1149,11 +1799,620 @@ void add_admin_shape(boost::filesystem::path admin_shape_file, bool test = false
 
     int feature_count = layer->GetFeatureCount(false);
     assert(feature_count >= 0);
+    count_rows(feature_count);
     for (auto i = 0; i < feature_count; i++) {
         ogr_feature_uptr feat(layer->GetFeature(i));
         process_admin_boundary(layer, feat);
         feat.release();
+        flush_node_buffer();
+        flush_way_buffer();
+        flush_rel_buffer();
+    }
+}
+
+// number of Adminbndy features an admin worker processes at once, few features are huge (countries)
+static constexpr int ADMIN_BATCH_SIZE = 16;
+// initial size of the buffers of an admin worker per task, they grow if needed
+static constexpr size_t ADMIN_BATCH_BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * \brief range of features of an Adminbndy shape file, processed by one admin worker.
+ */
+struct admin_task {
+    size_t file_index;
+    int first_feature;
+    int end_feature;
+};
+
+/**
+ * \brief objects created by an admin worker on a task.
+ */
+struct admin_worker_result {
+    size_t sequence = 0;
+    osmium::memory::Buffer node_buffer;
+    osmium::memory::Buffer way_buffer;
+    osmium::memory::Buffer rel_buffer;
+    osmium::unsigned_object_id_type end_osm_id = STREET_WORKER_FIRST_ID;
+    std::exception_ptr exception;
+};
+
+typedef std::unique_ptr<admin_worker_result> admin_worker_result_uptr;
+
+/**
+ * \brief tasks and progress shared by the admin workers and the committer.
+ *        Workers take the tasks in order and start a task only while fewer than max_tasks_in_flight
+ *        are uncommitted, which bounds the memory, so the result queue never overflows.
+ *        Workers and committer sleep on the monitor while they have to wait.
+ */
+struct admin_pipeline {
+    const path_vector_type& files;
+    std::vector<admin_task> tasks;
+    size_t max_tasks_in_flight;
+    bounded_queue<admin_worker_result_uptr> results;
+    std::atomic<size_t> next_task;
+    std::atomic<size_t> committed_tasks;
+    // aborted if the committer failed or received a failed task, the workers stop then
+    pipeline_monitor monitor;
+
+    admin_pipeline(const path_vector_type& files, size_t max_tasks_in_flight) :
+            files(files), max_tasks_in_flight(max_tasks_in_flight), results(max_tasks_in_flight), next_task(0), committed_tasks(
+                    0) {
+    }
+
+    /**
+     * \brief waits until task sequence may be started.
+     * \return false if the pipeline has been aborted.
+     */
+    bool wait_for_task(size_t sequence) {
+        return monitor.wait([this, sequence] {return sequence < committed_tasks + max_tasks_in_flight;});
+    }
+};
+
+/**
+ * \brief processes tasks of the admin pipeline until all are taken.
+ *        Every worker opens its own layers, objects are created in the thread local buffers with ids
+ *        starting at STREET_WORKER_FIRST_ID. g_mtd_area_map and g_lang_code_map are only read.
+ */
+void admin_worker(admin_pipeline& pipeline) {
+    ogr_layer_uptr_vector layers(pipeline.files.size());
+    while (!pipeline.monitor.aborted()) {
+        size_t sequence = pipeline.next_task++;
+        if (sequence >= pipeline.tasks.size() || !pipeline.wait_for_task(sequence)) break;
+        const admin_task& task = pipeline.tasks.at(sequence);
+
+        admin_worker_result_uptr result(new admin_worker_result());
+        result->sequence = sequence;
+        try {
+            auto& layer = layers.at(task.file_index);
+            if (!layer) layer.reset(read_shape_file(pipeline.files.at(task.file_index), cnull));
+            g_osm_id = STREET_WORKER_FIRST_ID;
+            g_node_buffer = osmium::memory::Buffer(ADMIN_BATCH_BUFFER_SIZE);
+            g_way_buffer = osmium::memory::Buffer(ADMIN_BATCH_BUFFER_SIZE);
+            g_rel_buffer = osmium::memory::Buffer(ADMIN_BATCH_BUFFER_SIZE);
+            for (int i = task.first_feature; i < task.end_feature; i++) {
+                ogr_feature_uptr feat(layer->GetFeature(i));
+                process_admin_boundary(layer, feat);
+                feat.release();
+            }
+
+            result->node_buffer = std::move(g_node_buffer);
+            result->way_buffer = std::move(g_way_buffer);
+            result->rel_buffer = std::move(g_rel_buffer);
+            result->end_osm_id = g_osm_id;
+        } catch (...) {
+            result->exception = std::current_exception();
+        }
+        if (!pipeline.monitor.push(pipeline.results, result)) break;
+    }
+}
+
+/**
+ * \brief appends the objects of an admin worker to the global buffers.
+ *        Worker ids are replaced by consecutive ids starting at g_osm_id, so merging the tasks in
+ *        order of their features yields the same ids as processing all features in one thread.
+ */
+void merge_admin_worker_result(admin_worker_result& result) {
+    osmium::unsigned_object_id_type first_osm_id = g_osm_id;
+    auto renumber = [first_osm_id](osmium::unsigned_object_id_type id) {
+        assert(id >= STREET_WORKER_FIRST_ID);
+        return first_osm_id + (id - STREET_WORKER_FIRST_ID);
+    };
+
+    for (auto it = result.node_buffer.begin<osmium::Node>(); it != result.node_buffer.end<osmium::Node>(); ++it)
+        it->set_id(renumber(it->id()));
+    for (auto it = result.way_buffer.begin<osmium::Way>(); it != result.way_buffer.end<osmium::Way>(); ++it) {
+        it->set_id(renumber(it->id()));
+        for (auto& node_ref : it->nodes())
+            node_ref.set_ref(renumber(node_ref.ref()));
+    }
+    for (auto it = result.rel_buffer.begin<osmium::Relation>(); it != result.rel_buffer.end<osmium::Relation>();
+            ++it) {
+        it->set_id(renumber(it->id()));
+        for (auto& member : it->members())
+            member.set_ref(renumber(member.ref()));
+    }
+
+    g_node_buffer.add_buffer(result.node_buffer);
+    g_node_buffer.commit();
+    g_way_buffer.add_buffer(result.way_buffer);
+    g_way_buffer.commit();
+    g_rel_buffer.add_buffer(result.rel_buffer);
+    g_rel_buffer.commit();
+
+    g_osm_id = renumber(result.end_osm_id);
+}
+
+/**
+ * \brief adds administrative boundaries of admin_shape_files in this order.
+ *        With more than one thread, admin workers process ranges of ADMIN_BATCH_SIZE features of
+ *        all files and the calling thread merges their results in order of the features and hands
+ *        them to the writer. The output doesn't depend on the number of threads.
+ */
+void add_admin_shapes(const path_vector_type& admin_shape_files, bool test = false, unsigned int threads = 1) {
+    if (threads <= 1) {
+        for (auto& admin_shape_file : admin_shape_files)
+            add_admin_shape(admin_shape_file, test);
+        return;
+    }
+
+    std::ostream& out = test ? cnull : std::cerr;
+    admin_pipeline pipeline(admin_shape_files, 4 * threads);
+    for (size_t i = 0; i < admin_shape_files.size(); i++) {
+        ogr_layer_uptr layer(read_shape_file(admin_shape_files.at(i), out));
+        assert(layer->GetGeomType() == wkbPolygon);
+        int feature_count = layer->GetFeatureCount(false);
+        assert(feature_count >= 0);
+        count_rows(feature_count);
+        for (int first = 0; first < feature_count; first += ADMIN_BATCH_SIZE)
+            pipeline.tasks.push_back(admin_task { i, first, std::min(first + ADMIN_BATCH_SIZE, feature_count) });
+    }
+    // otherwise parsed lazily by the first call of parse_lang_code()
+    if (!g_mtd_area_map.empty() && g_lang_code_map.empty()) parse_lang_code_file();
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.push_back(std::thread(admin_worker, std::ref(pipeline)));
+
+    // results which arrived before the results of preceding tasks
+    std::map<size_t, admin_worker_result_uptr> pending_results;
+    std::exception_ptr exception;
+    size_t next_sequence = 0;
+    try {
+        while (next_sequence != pipeline.tasks.size()) {
+            admin_worker_result_uptr result;
+            if (!pipeline.monitor.pop(pipeline.results, result)) break;
+            if (result->exception) std::rethrow_exception(result->exception);
+            pending_results.insert(std::make_pair(result->sequence, std::move(result)));
+            for (auto it = pending_results.begin(); it != pending_results.end() && it->first == next_sequence; it =
+                    pending_results.erase(it)) {
+                merge_admin_worker_result(*it->second);
+                pipeline.committed_tasks = ++next_sequence;
+                pipeline.monitor.notify();
+                flush_node_buffer();
+                flush_way_buffer();
+                flush_rel_buffer();
+            }
+        }
+    } catch (...) {
+        exception = std::current_exception();
+        pipeline.monitor.abort();
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+    if (exception) std::rethrow_exception(exception);
+}
+
+/****************************************************
+ * administrative boundary topology
+ ****************************************************/
+
+/**
+ * \brief Rings of all administrative boundaries as sequences of distinct vertices.
+ *
+ *        Borders of neighbouring areas and of areas on different admin levels consist of the
+ *        same vertices. Rings are split into edges at junctions, i.e. vertices which don't have
+ *        exactly two neighbours, and every edge is built once as node sequence. Rings without
+ *        junctions (islands, areas equal to their parent area) form one edge starting at their
+ *        smallest location, so equal rings give the same edge.
+ */
+class admin_topology {
+public:
+    typedef uint32_t vertex_type;
+
+private:
+    // vertex index of every distinct location
+    location_id_index m_vertex_index;
+    std::vector<osmium::Location> m_locations;
+    // vertices of ring i are m_ring_vertices[m_first_vertices[i], m_first_vertices[i + 1]), without closing vertex
+    std::vector<vertex_type> m_ring_vertices;
+    std::vector<size_t> m_first_vertices;
+    std::vector<bool> m_inner_rings;
+    // rings of feature i are [m_first_rings[i], m_first_rings[i + 1])
+    std::vector<size_t> m_first_rings;
+    std::vector<bool> m_junctions;
+    // node ids of the vertices, 0 until the node is built
+    std::vector<osmium::unsigned_object_id_type> m_node_ids;
+    // ways of the edges by their first two vertices in canonical direction
+    std::unordered_map<uint64_t, osm_id_vector_type> m_edge_ways;
+
+    static uint64_t vertex_pair(vertex_type first, vertex_type second) {
+        return (uint64_t(first) << 32) | second;
+    }
+
+    vertex_type vertex(const osmium::Location& location) {
+        if (m_vertex_index.insert(location, m_locations.size())) m_locations.push_back(location);
+        return m_vertex_index.at(location);
+    }
+
+    void add_polygon(OGRPolygon* poly) {
+        add_ring(poly->getExteriorRing(), false);
+        for (int i = 0; i < poly->getNumInteriorRings(); i++)
+            add_ring(poly->getInteriorRing(i), true);
+    }
+
+    /**
+     * \brief adds the ways of edge to way_ids, builds them unless another ring has done before.
+     *        An edge is identified by its first two vertices in the direction in which they are smaller.
+     */
+    void add_edge_ways(const std::vector<vertex_type>& edge, osm_id_vector_type& way_ids) {
+        assert(edge.size() >= 2);
+        auto forward = std::make_pair(edge.front(), edge.at(1));
+        auto backward = std::make_pair(edge.back(), edge.at(edge.size() - 2));
+        bool reverse = backward < forward;
+        uint64_t key = reverse ?
+                vertex_pair(backward.first, backward.second) : vertex_pair(forward.first, forward.second);
+
+        auto it = m_edge_ways.find(key);
+        if (it == m_edge_ways.end()) {
+            node_vector_type osm_way_node_ids;
+            for (size_t i = 0; i < edge.size(); i++) {
+                vertex_type v = reverse ? edge.at(edge.size() - 1 - i) : edge.at(i);
+                if (!m_node_ids.at(v)) m_node_ids.at(v) = build_node(m_locations.at(v));
+                osm_way_node_ids.push_back(loc_osmid_pair_type(m_locations.at(v), m_node_ids.at(v)));
+            }
+            it = m_edge_ways.insert(std::make_pair(key, build_admin_boundary_ways(osm_way_node_ids))).first;
+        }
+        way_ids.insert(way_ids.end(), it->second.begin(), it->second.end());
+    }
+
+    /**
+     * \brief splits ring at its junctions and adds the ways of the edges to way_ids.
+     */
+    void build_ring_ways(size_t ring, osm_id_vector_type& way_ids) {
+        const vertex_type* vertices = m_ring_vertices.data() + m_first_vertices.at(ring);
+        size_t n = m_first_vertices.at(ring + 1) - m_first_vertices.at(ring);
+        assert(n >= 3);
+
+        size_t start = n;
+        for (size_t i = 0; i < n && start == n; i++)
+            if (m_junctions.at(vertices[i])) start = i;
+        if (start == n) {
+            start = 0;
+            for (size_t i = 1; i < n; i++)
+                if (m_locations.at(vertices[i]) < m_locations.at(vertices[start])) start = i;
+        }
+
+        std::vector<vertex_type> edge;
+        size_t i = 0;
+        while (i < n) {
+            edge.assign(1, vertices[(start + i) % n]);
+            do {
+                i++;
+                edge.push_back(vertices[(start + i) % n]);
+            } while (i < n && !m_junctions.at(edge.back()));
+            add_edge_ways(edge, way_ids);
+        }
+    }
+
+public:
+    admin_topology() :
+            m_first_vertices(1, 0), m_first_rings(1, 0) {
+    }
+
+    size_t feature_count() const {
+        return m_first_rings.size() - 1;
+    }
+
+    /**
+     * \brief adds ring to the current feature. Consecutive duplicate points are dropped.
+     *        Rings of less than three distinct points enclose no area and are rejected.
+     */
+    void add_ring(OGRLinearRing* ring, bool inner) {
+        int n = ring->getNumPoints();
+        if (n == 0
+                || osmium::Location(ring->getX(0), ring->getY(0))
+                        != osmium::Location(ring->getX(n - 1), ring->getY(n - 1)))
+            throw format_error("admin boundary ring is invalid. First and last node don't match");
+
+        size_t first_vertex = m_ring_vertices.size();
+        for (int i = 0; i < n - 1; i++) {
+            vertex_type v = vertex(osmium::Location(ring->getX(i), ring->getY(i)));
+            if (m_ring_vertices.size() == first_vertex || m_ring_vertices.back() != v) m_ring_vertices.push_back(v);
+        }
+        if (m_ring_vertices.size() > first_vertex + 1 && m_ring_vertices.back() == m_ring_vertices.at(first_vertex))
+            m_ring_vertices.pop_back();
+        if (m_ring_vertices.size() < first_vertex + 3) {
+            m_ring_vertices.resize(first_vertex);
+            throw format_error("admin boundary ring is invalid. It has less than three distinct nodes");
+        }
+        m_first_vertices.push_back(m_ring_vertices.size());
+        m_inner_rings.push_back(inner);
+    }
+
+    /**
+     * \brief adds the rings of a polygon or multipolygon as next feature.
+     */
+    void add_feature(OGRGeometry* geom) {
+        auto geom_type = geom->getGeometryType();
+        if (geom_type == wkbMultiPolygon) {
+            OGRMultiPolygon* mp = static_cast<OGRMultiPolygon*>(geom);
+            for (int i = 0; i < mp->getNumGeometries(); i++)
+                add_polygon(static_cast<OGRPolygon*>(mp->getGeometryRef(i)));
+        } else if (geom_type == wkbPolygon) {
+            add_polygon(static_cast<OGRPolygon*>(geom));
+        } else {
+            throw(std::runtime_error(
+                    "Adminboundaries with geometry=" + std::string(geom->getGeometryName())
+                            + " are not yet supported."));
+        }
+        end_feature();
+    }
+
+    /**
+     * \brief finishes the rings of the current feature.
+     */
+    void end_feature() {
+        m_first_rings.push_back(m_inner_rings.size());
+    }
+
+    /**
+     * \brief marks the vertices which don't have exactly two distinct neighbours in all rings.
+     *        Must be called after all features have been added.
+     */
+    void find_junctions() {
+        assert(m_locations.size() <= std::numeric_limits<vertex_type>::max());
+        std::vector<uint64_t> segments;
+        segments.reserve(m_ring_vertices.size());
+        for (size_t ring = 0; ring + 1 < m_first_vertices.size(); ring++) {
+            size_t first = m_first_vertices.at(ring), end = m_first_vertices.at(ring + 1);
+            for (size_t i = first; i < end; i++) {
+                vertex_type a = m_ring_vertices.at(i);
+                vertex_type b = m_ring_vertices.at(i + 1 < end ? i + 1 : first);
+                if (a != b) segments.push_back(a < b ? vertex_pair(a, b) : vertex_pair(b, a));
+            }
+        }
+        std::sort(segments.begin(), segments.end());
+        segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+
+        std::vector<uint8_t> neighbours(m_locations.size(), 0);
+        for (uint64_t segment : segments) {
+            // counting stops at 3, more neighbours make no difference
+            uint8_t& first = neighbours.at(segment >> 32);
+            uint8_t& second = neighbours.at(uint32_t(segment));
+            if (first < 3) first++;
+            if (second < 3) second++;
+        }
+        m_junctions.assign(m_locations.size(), false);
+        for (size_t v = 0; v < m_locations.size(); v++)
+            m_junctions.at(v) = neighbours.at(v) != 2;
+        m_node_ids.assign(m_locations.size(), 0);
+    }
+
+    /**
+     * \brief builds the nodes and ways of the rings of feature which haven't been built for
+     *        preceding features and returns the ways of its exterior and interior rings.
+     */
+    void build_feature_ways(size_t feature, osm_id_vector_type& exterior_way_ids,
+            osm_id_vector_type& interior_way_ids) {
+        for (size_t ring = m_first_rings.at(feature); ring < m_first_rings.at(feature + 1); ring++)
+            build_ring_ways(ring, m_inner_rings.at(ring) ? interior_way_ids : exterior_way_ids);
+    }
+};
+
+/**
+ * \brief adds administrative boundaries of admin_shape_files with shared borders.
+ *        The rings of all files are read first to find the junctions, then the relations are
+ *        built feature by feature and refer to the ways of the borders built before.
+ */
+void add_admin_shapes_topology(const path_vector_type& admin_shape_files, bool test = false) {
+    std::ostream& out = test ? cnull : std::cerr;
+
+    admin_topology topology;
+    for (auto& admin_shape_file : admin_shape_files) {
+        ogr_layer_uptr layer(read_shape_file(admin_shape_file, out));
+        assert(layer->GetGeomType() == wkbPolygon);
+        int feature_count = layer->GetFeatureCount(false);
+        assert(feature_count >= 0);
+        count_rows(feature_count);
+        for (int i = 0; i < feature_count; i++) {
+            ogr_feature_uptr feat(layer->GetFeature(i));
+            topology.add_feature(feat->GetGeometryRef());
+        }
+    }
+    topology.find_junctions();
+
+    size_t feature = 0;
+    for (auto& admin_shape_file : admin_shape_files) {
+        ogr_layer_uptr layer(read_shape_file(admin_shape_file, out));
+        int feature_count = layer->GetFeatureCount(false);
+        for (int i = 0; i < feature_count; i++) {
+            ogr_feature_uptr feat(layer->GetFeature(i));
+            osm_id_vector_type exterior_way_ids, interior_way_ids;
+            topology.build_feature_ways(feature++, exterior_way_ids, interior_way_ids);
+            build_admin_boundary_relation_with_tags(layer, feat, exterior_way_ids, interior_way_ids);
+            g_node_buffer.commit();
+            g_way_buffer.commit();
+            g_rel_buffer.commit();
+            flush_node_buffer();
+            flush_way_buffer();
+            flush_rel_buffer();
+        }
+    }
+    assert(feature == topology.feature_count());
+}
+
+/****************************************************
+ * directory pipelines
+ ****************************************************/
+
+/**
+ * \brief first id of the range reserved for the objects of directory dir_index out of dir_count
+ *        directories, which are converted in separate processes. The ranges end below
+ *        STREET_WORKER_FIRST_ID, so street workers can be used within the processes.
+ */
+osmium::unsigned_object_id_type dir_pipeline_first_id(size_t dir_index, size_t dir_count) {
+    return 1 + dir_index * ((STREET_WORKER_FIRST_ID - 1) / dir_count);
+}
+
+/**
+ * \brief files in which a directory pipeline passes its objects and end points to the merging process.
+ */
+struct dir_pipeline_files {
+    std::string nodes;
+    std::string ways;
+    std::string relations;
+    std::string end_points;
+
+    explicit dir_pipeline_files(const boost::filesystem::path& prefix) :
+            nodes(prefix.string() + ".nodes"), ways(prefix.string() + ".ways"), relations(
+                    prefix.string() + ".relations"), end_points(prefix.string() + ".end_points") {
+    }
+};
+
+// header of the end points file of a directory pipeline
+struct dir_pipeline_ids {
+    // reserved range of the pipeline and the first id it didn't use
+    osmium::unsigned_object_id_type first_id;
+    osmium::unsigned_object_id_type end_id;
+    uint64_t end_point_count;
+    // features and records read by the pipeline, for the statistics of the parent
+    uint64_t rows;
+};
+
+/**
+ * \return end points of zero z-level (g_way_end_points_map) and other z-levels (g_z_lvl_nodes_map).
+ */
+dir_end_point_vector collect_end_points() {
+    dir_end_point_vector end_points;
+    end_points.reserve(g_way_end_points_map.size() + g_z_lvl_nodes_map.size());
+    g_way_end_points_map.for_each([&end_points](const osmium::Location& location, osmium::unsigned_object_id_type id) {
+        end_points.push_back(dir_end_point { location, 0, id });
+    });
+    g_z_lvl_nodes_map.for_each(
+            [&end_points](const osmium::Location& location, z_lvl_type z_lvl, osmium::unsigned_object_id_type id) {
+                end_points.push_back(dir_end_point { location, z_lvl, id });
+            });
+    return end_points;
+}
+
+/**
+ * \brief writes the objects of the global buffers and end_points of a directory pipeline to files.
+ * \param first_id first id of the range reserved for the pipeline.
+ * \param rows features and records read by the pipeline.
+ */
+void write_dir_pipeline_result(const dir_pipeline_files& files, osmium::unsigned_object_id_type first_id,
+        const dir_end_point_vector& end_points, uint64_t rows = 0) {
+    g_node_buffer.commit();
+    g_way_buffer.commit();
+    g_rel_buffer.commit();
+    write_buffer_file(g_node_buffer, files.nodes);
+    write_buffer_file(g_way_buffer, files.ways);
+    write_buffer_file(g_rel_buffer, files.relations);
+
+    FILE* file = fopen(files.end_points.c_str(), "wb");
+    if (!file) throw(osmium::io_error("could not create " + files.end_points));
+    dir_pipeline_ids ids { first_id, g_osm_id, end_points.size(), rows };
+    bool written = fwrite(&ids, sizeof(ids), 1, file) == 1
+            && fwrite(end_points.data(), sizeof(dir_end_point), end_points.size(), file) == end_points.size();
+    if (fclose(file) != 0 || !written) throw(osmium::io_error("could not write " + files.end_points));
+}
+
+/**
+ * \return header of the end points file of a directory pipeline.
+ */
+dir_pipeline_ids read_dir_pipeline_ids(const dir_pipeline_files& files) {
+    FILE* file = fopen(files.end_points.c_str(), "rb");
+    if (!file) throw(osmium::io_error("could not open " + files.end_points));
+    dir_pipeline_ids ids;
+    bool read = fread(&ids, sizeof(ids), 1, file) == 1;
+    fclose(file);
+    if (!read) throw(osmium::io_error("could not read " + files.end_points));
+    return ids;
+}
+
+/**
+ * \brief appends the objects of a directory pipeline to the global buffers.
+ *        Ids of the reserved range are replaced by consecutive ids starting at g_osm_id, so merging
+ *        the pipelines in order of their directories gives reproducible ids. Nodes at an end point of
+ *        a previously merged directory (same location and z-level) are dropped and their references
+ *        are replaced by that end point, which connects the ways at the borders of the directories.
+ * \param end_points end points of the merged directories, the end points of the pipeline are added.
+ */
+void merge_dir_pipeline_result(const dir_pipeline_files& files, z_lvl_nodes_map_type& end_points) {
+    FILE* file = fopen(files.end_points.c_str(), "rb");
+    if (!file) throw(osmium::io_error("could not open " + files.end_points));
+    dir_pipeline_ids ids;
+    dir_end_point_vector pipeline_end_points;
+    bool read = fread(&ids, sizeof(ids), 1, file) == 1;
+    if (read) {
+        pipeline_end_points.resize(ids.end_point_count);
+        read = fread(pipeline_end_points.data(), sizeof(dir_end_point), ids.end_point_count, file)
+                == ids.end_point_count;
+    }
+    fclose(file);
+    if (!read) throw(osmium::io_error("could not read " + files.end_points));
+
+    osmium::unsigned_object_id_type first_osm_id = g_osm_id;
+    auto renumber = [first_osm_id, &ids](osmium::unsigned_object_id_type id) {
+        assert(id >= ids.first_id && id < ids.end_id);
+        return first_osm_id + (id - ids.first_id);
+    };
+
+    // end points of the pipeline which already exist in another directory
+    std::unordered_map<osmium::unsigned_object_id_type, osmium::unsigned_object_id_type> joined;
+    for (auto& end_point : pipeline_end_points) {
+        osmium::unsigned_object_id_type id = renumber(end_point.id);
+        if (!end_points.insert(end_point.location, end_point.z_lvl, id))
+            joined.insert(std::make_pair(id, end_points.at(end_point.location, end_point.z_lvl)));
+    }
+    std::vector<dir_end_point>().swap(pipeline_end_points);
+    auto resolve = [&renumber, &joined](osmium::unsigned_object_id_type id) {
+        auto it = joined.find(renumber(id));
+        return it == joined.end() ? renumber(id) : it->second;
+    };
+
+    osmium::memory::Buffer node_buffer = read_buffer_file(files.nodes);
+    for (auto it = node_buffer.begin<osmium::Node>(); it != node_buffer.end<osmium::Node>(); ++it) {
+        osmium::unsigned_object_id_type id = renumber(it->id());
+        if (joined.count(id)) continue;
+        it->set_id(id);
+        g_node_buffer.add_item(*it);
+        g_node_buffer.commit();
+        flush_node_buffer();
+    }
+
+    osmium::memory::Buffer way_buffer = read_buffer_file(files.ways);
+    for (auto it = way_buffer.begin<osmium::Way>(); it != way_buffer.end<osmium::Way>(); ++it) {
+        it->set_id(renumber(it->id()));
+        for (auto& node_ref : it->nodes())
+            node_ref.set_ref(resolve(node_ref.ref()));
+    }
+    g_way_buffer.add_buffer(way_buffer);
+    g_way_buffer.commit();
+    flush_way_buffer();
+
+    osmium::memory::Buffer rel_buffer = read_buffer_file(files.relations);
+    for (auto it = rel_buffer.begin<osmium::Relation>(); it != rel_buffer.end<osmium::Relation>(); ++it) {
+        it->set_id(renumber(it->id()));
+        for (auto& member : it->members())
+            member.set_ref(resolve(member.ref()));
     }
+    g_rel_buffer.add_buffer(rel_buffer);
+    g_rel_buffer.commit();
+    flush_rel_buffer();
+
+    g_osm_id = first_osm_id + (ids.end_id - ids.first_id);
 }
 
 /****************************************************
@@ -1169,9 +2428,15 @@ void clear_all() {
     g_way_buffer.clear();
     g_rel_buffer.clear();
     g_osm_id = 1;
-    g_link_id_map.clear();
-    g_way_offset_map.clear();
+    g_link_ways.clear();
     g_mtd_area_map.clear();
+    g_way_end_points_map.clear();
+    g_z_lvl_nodes_map.clear();
+    g_cnd_mod_rows.clear();
+    g_cdms_map.clear();
+    g_link_restrictions.clear();
+    g_area_to_govt_code_map.clear();
+    g_cntry_ref_map.clear();
 }
 
 void add_buffer_ids(osm_id_vector_type& v, osmium::memory::Buffer& buf) {
@@ -29,7 +29,7 @@ void add_highway_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr&
 	const char* residential = "residential";
 	const char* unclassified = "unclassified";
 
-	bool urban = parse_bool(get_field_from_feature(f, URBAN));
+	bool urban = parse_bool(get_field_from_feature(f, SF_URBAN));
 
 	if (link_id == 871827859){
 		std::cout << link_id << " - route_type=" << route_type << ", func_class=" << func_class << std::endl;
@@ -106,17 +106,17 @@ void add_one_way_tag(osmium::builder::TagListBuilder* builder, const char* value
 }
 
 void add_access_tags(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-    if (! parse_bool(get_field_from_feature(f, AR_AUTO))) builder->add_tag("motorcar",  NO);
-    if (! parse_bool(get_field_from_feature(f, AR_BUS))) builder->add_tag("bus",  NO);
-    if (! parse_bool(get_field_from_feature(f, AR_TAXIS))) builder->add_tag("taxi",  NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_AUTO))) builder->add_tag("motorcar",  NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_BUS))) builder->add_tag("bus",  NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_TAXIS))) builder->add_tag("taxi",  NO);
 //    if (! parse_bool(get_field_from_feature(f, AR_CARPOOL))) builder->add_tag("hov",  NO);
-    if (! parse_bool(get_field_from_feature(f, AR_PEDESTRIANS))) builder->add_tag("foot",  NO);
-    if (! parse_bool(get_field_from_feature(f, AR_TRUCKS))) builder->add_tag("hgv", NO);
-    if (! parse_bool(get_field_from_feature(f, AR_EMERVEH))) builder->add_tag("emergency",  NO);
-    if (! parse_bool(get_field_from_feature(f, AR_MOTORCYCLES))) builder->add_tag("motorcycle",  NO);
-    if (!parse_bool(get_field_from_feature(f, PUB_ACCESS)) || parse_bool(get_field_from_feature(f, PRIVATE))){
+    if (! parse_bool(get_field_from_feature(f, SF_AR_PEDESTRIANS))) builder->add_tag("foot",  NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_TRUCKS))) builder->add_tag("hgv", NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_EMERVEH))) builder->add_tag("emergency",  NO);
+    if (! parse_bool(get_field_from_feature(f, SF_AR_MOTORCYCLES))) builder->add_tag("motorcycle",  NO);
+    if (!parse_bool(get_field_from_feature(f, SF_PUB_ACCESS)) || parse_bool(get_field_from_feature(f, SF_PRIVATE))){
         builder->add_tag("access", "private");
-    } else if (!parse_bool(get_field_from_feature(f, AR_THROUGH_TRAFFIC))){
+    } else if (!parse_bool(get_field_from_feature(f, SF_AR_THROUGH_TRAFFIC))){
         builder->add_tag("access", "destination");
     }
 }
@@ -172,11 +172,11 @@ std::string to_camel_case_with_spaces(const char* camel) {
  * \brief adds maxspeed tag
  */
 void add_maxspeed_tags(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-    const char* from_speed_limit_s = strdup(get_field_from_feature(f, FR_SPEED_LIMIT));
-    const char* to_speed_limit_s = strdup(get_field_from_feature(f, TO_SPEED_LIMIT));
+    const char* from_speed_limit_s = strdup(get_field_from_feature(f, SF_FR_SPEED_LIMIT));
+    const char* to_speed_limit_s = strdup(get_field_from_feature(f, SF_TO_SPEED_LIMIT));
 
-    uint from_speed_limit = get_uint_from_feature(f, FR_SPEED_LIMIT);
-    uint to_speed_limit = get_uint_from_feature(f, TO_SPEED_LIMIT);
+    uint from_speed_limit = get_uint_from_feature(f, SF_FR_SPEED_LIMIT);
+    uint to_speed_limit = get_uint_from_feature(f, SF_TO_SPEED_LIMIT);
 
     if (from_speed_limit >= 1000 || to_speed_limit >= 1000)
         throw(format_error(
@@ -214,7 +214,7 @@ void add_maxspeed_tags(osmium::builder::TagListBuilder* builder, ogr_feature_upt
  * \brief adds here:speed_cat tag
  */
 void add_here_speed_cat_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-    auto speed_cat = get_uint_from_feature(f, SPEED_CAT);
+    auto speed_cat = get_uint_from_feature(f, SF_SPEED_CAT);
     if (0 < speed_cat && speed_cat < (sizeof(speed_cat_metric) / sizeof(const char*))) builder->add_tag(
             "here:speed_cat", speed_cat_metric[speed_cat]);
     else throw format_error("SPEED_CAT=" + std::to_string(speed_cat) + " is not valid.");
@@ -257,13 +257,36 @@ bool is_imperial(area_id_type l_area_id, area_id_type r_area_id, area_id_govt_co
     return false;
 }
 
+/**
+ * \brief returns the restriction of a CndMod.dbf MOD_TYPE or restriction_count for other modifications.
+ */
+link_restrictions_type::restriction restriction_of_mod_type(mod_typ_type mod_type) {
+    switch (mod_type) {
+        case MT_HEIGHT_RESTRICTION:
+            return link_restrictions_type::height;
+        case MT_WIDTH_RESTRICTION:
+            return link_restrictions_type::width;
+        case MT_LENGTH_RESTRICTION:
+            return link_restrictions_type::length;
+        case MT_WEIGHT_RESTRICTION:
+            return link_restrictions_type::weight;
+        case MT_WEIGHT_PER_AXLE_RESTRICTION:
+            return link_restrictions_type::axleload;
+        default:
+            return link_restrictions_type::restriction_count;
+    }
+}
+
 /**
  * \brief adds maxheight, maxwidth, maxlength, maxweight and maxaxleload tags.
+ * \param restrictions restrictions of links joined from Cdms.dbf and CndMod.dbf.
  */
 void add_additional_restrictions(osmium::builder::TagListBuilder* builder, link_id_type link_id, area_id_type l_area_id,
-        area_id_type r_area_id, cdms_map_type* cdms_map, cnd_mod_map_type* cnd_mod_map,
+        area_id_type r_area_id, const link_restrictions_index* restrictions,
         area_id_govt_code_map_type* area_govt_map, cntry_ref_map_type* cntry_map) {
-    if (!cdms_map || !cnd_mod_map) return;
+    if (!restrictions) return;
+    const link_restrictions_type* link = restrictions->find(link_id);
+    if (!link) return;
 
     // default is metric units
     bool imperial_units = false;
@@ -271,40 +294,26 @@ void add_additional_restrictions(osmium::builder::TagListBuilder* builder, link_
         imperial_units = is_imperial(l_area_id, r_area_id, area_govt_map, cntry_map);
     }
 
-    uint64_t max_height = 0, max_width = 0, max_length = 0, max_weight = 0, max_axleload = 0;
-
-    auto range = cdms_map->equal_range(link_id);
-    for (auto it = range.first; it != range.second; ++it) {
-        cond_id_type cond_id = it->second;
-        auto it2 = cnd_mod_map->find(cond_id);
-        if (it2 != cnd_mod_map->end()) {
-            auto mod_group = it2->second;
-            auto mod_type = mod_group.mod_type;
-            auto mod_val = mod_group.mod_val;
-			if (mod_type == MT_HEIGHT_RESTRICTION) {
-				if (!max_height || mod_val < max_height)
-					max_height = mod_val;
-			} else if (mod_type == MT_WIDTH_RESTRICTION) {
-				if (!max_width || mod_val < max_width)
-					max_width = mod_val;
-			} else if (mod_type == MT_LENGTH_RESTRICTION) {
-				if (!max_length || mod_val < max_length)
-					max_length = mod_val;
-			} else if (mod_type == MT_WEIGHT_RESTRICTION) {
-				if (!max_weight || mod_val < max_weight)
-					max_weight = mod_val;
-			} else if (mod_type == MT_WEIGHT_PER_AXLE_RESTRICTION) {
-				if (!max_axleload || mod_val < max_axleload)
-					max_axleload = mod_val;
-			}
-        }
+    if (link->has(link_restrictions_type::height)) {
+        mod_val_type max_height = link->values[link_restrictions_type::height];
+        builder->add_tag("maxheight", imperial_units ? inch_to_feet(max_height) : cm_to_m(max_height));
+    }
+    if (link->has(link_restrictions_type::width)) {
+        mod_val_type max_width = link->values[link_restrictions_type::width];
+        builder->add_tag("maxwidth", imperial_units ? inch_to_feet(max_width) : cm_to_m(max_width));
+    }
+    if (link->has(link_restrictions_type::length)) {
+        mod_val_type max_length = link->values[link_restrictions_type::length];
+        builder->add_tag("maxlength", imperial_units ? inch_to_feet(max_length) : cm_to_m(max_length));
+    }
+    if (link->has(link_restrictions_type::weight)) {
+        mod_val_type max_weight = link->values[link_restrictions_type::weight];
+        builder->add_tag("maxweight", imperial_units ? lbs_to_metric_ton(max_weight) : kg_to_t(max_weight));
+    }
+    if (link->has(link_restrictions_type::axleload)) {
+        mod_val_type max_axleload = link->values[link_restrictions_type::axleload];
+        builder->add_tag("maxaxleload", imperial_units ? lbs_to_metric_ton(max_axleload) : kg_to_t(max_axleload));
     }
-
-	if (max_height > 0) builder->add_tag("maxheight", imperial_units ? inch_to_feet(max_height) : cm_to_m(max_height));
-	if (max_width > 0)  builder->add_tag("maxwidth", imperial_units ? inch_to_feet(max_width) : cm_to_m(max_width));
-	if (max_length > 0)  builder->add_tag("maxlength", imperial_units ? inch_to_feet(max_length) : cm_to_m(max_length));
-	if (max_weight > 0)  builder->add_tag("maxweight", imperial_units ? lbs_to_metric_ton(max_weight) : kg_to_t(max_weight));
-	if (max_axleload > 0)  builder->add_tag("maxaxleload", imperial_units ? lbs_to_metric_ton(max_axleload) : kg_to_t(max_axleload));
 }
 
 bool is_ferry(const char* value) {
@@ -315,26 +324,26 @@ bool is_ferry(const char* value) {
 }
 
 bool only_pedestrians(ogr_feature_uptr& f) {
-    if (strcmp(get_field_from_feature(f, AR_PEDESTRIANS), "Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_AUTO),"Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_BUS),"Y")) return false;
+    if (strcmp(get_field_from_feature(f, SF_AR_PEDESTRIANS), "Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_AUTO),"Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_BUS),"Y")) return false;
 //    if (! strcmp(get_field_from_feature(f, AR_CARPOOL),"Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_EMERVEH),"Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_MOTORCYCLES),"Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_TAXIS),"Y")) return false;
-    if (! strcmp(get_field_from_feature(f, AR_THROUGH_TRAFFIC),"Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_EMERVEH),"Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_MOTORCYCLES),"Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_TAXIS),"Y")) return false;
+    if (! strcmp(get_field_from_feature(f, SF_AR_THROUGH_TRAFFIC),"Y")) return false;
     return true;
 }
 
 void add_ferry_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-    const char* ferry = get_field_from_feature(f, FERRY);
+    const char* ferry = get_field_from_feature(f, SF_FERRY);
     builder->add_tag("route", "ferry");
     if (!strcmp(ferry, "B")) {
         if (only_pedestrians(f)) {
             builder->add_tag("foot", YES);
         } else {
-            builder->add_tag("foot", parse_bool(get_field_from_feature(f, AR_PEDESTRIANS)) ? YES : NO);
-            builder->add_tag("motorcar", parse_bool(get_field_from_feature(f, AR_AUTO)) ? YES : NO);
+            builder->add_tag("foot", parse_bool(get_field_from_feature(f, SF_AR_PEDESTRIANS)) ? YES : NO);
+            builder->add_tag("motorcar", parse_bool(get_field_from_feature(f, SF_AR_AUTO)) ? YES : NO);
         }
 
     } else if (!strcmp(ferry, "R")) {
@@ -343,13 +352,13 @@ void add_ferry_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f
 }
 
 void add_lanes_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-    const char* number_of_physical_lanes = get_field_from_feature(f, PHYS_LANES);
+    const char* number_of_physical_lanes = get_field_from_feature(f, SF_PHYS_LANES);
     if (strcmp(number_of_physical_lanes, "0")) builder->add_tag("lanes", number_of_physical_lanes);
 }
 
 void add_postcode_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f) {
-	std::string l_postcode = get_field_from_feature(f, L_POSTCODE);
-	std::string r_postcode = get_field_from_feature(f, R_POSTCODE);
+	std::string l_postcode = get_field_from_feature(f, SF_L_POSTCODE);
+	std::string r_postcode = get_field_from_feature(f, SF_R_POSTCODE);
 
 	if (l_postcode.empty() && r_postcode.empty()) return;
 
@@ -360,60 +369,58 @@ void add_postcode_tag(osmium::builder::TagListBuilder* builder, ogr_feature_uptr
 	builder->add_tag("addr:postcode", postcode);
 }
 
-void add_highway_tags(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f, link_id_type link_id,
-        cdms_map_type* cdms_map, cnd_mod_map_type* cnd_mod_map) {
+void add_highway_tags(osmium::builder::TagListBuilder* builder, ogr_feature_uptr& f, link_id_type link_id) {
 
     uint route_type = 0, func_class = 0;
-    std::string route_type_s = get_field_from_feature(f, ROUTE);
-    std::string func_class_s = get_field_from_feature(f, FUNC_CLASS);
-	if (!route_type_s.empty()) route_type = get_uint_from_feature(f, ROUTE);
-	if (!func_class_s.empty()) func_class = get_uint_from_feature(f, FUNC_CLASS);
+    std::string route_type_s = get_field_from_feature(f, SF_ROUTE);
+    std::string func_class_s = get_field_from_feature(f, SF_FUNC_CLASS);
+	if (!route_type_s.empty()) route_type = get_uint_from_feature(f, SF_ROUTE);
+	if (!func_class_s.empty()) func_class = get_uint_from_feature(f, SF_FUNC_CLASS);
 
     add_highway_tag(builder, f, link_id, route_type, func_class);
-    add_one_way_tag(builder, get_field_from_feature(f, DIR_TRAVEL));
+    add_one_way_tag(builder, get_field_from_feature(f, SF_DIR_TRAVEL));
     add_access_tags(builder, f);
     add_maxspeed_tags(builder, f);
     add_lanes_tag(builder, f);
     add_postcode_tag(builder, f);
 
-    if (parse_bool(get_field_from_feature(f, PAVED))) builder->add_tag("surface", "paved");
-    if (parse_bool(get_field_from_feature(f, BRIDGE))) builder->add_tag("bridge", YES);
-    if (parse_bool(get_field_from_feature(f, TUNNEL))) builder->add_tag("tunnel", YES);
-    if (parse_bool(get_field_from_feature(f, TOLLWAY))) builder->add_tag("toll", YES);
-    if (parse_bool(get_field_from_feature(f, ROUNDABOUT))) builder->add_tag("junction", "roundabout");
-    if (parse_bool(get_field_from_feature(f, FOURWHLDR))) builder->add_tag("4wd_only", YES);
+    if (parse_bool(get_field_from_feature(f, SF_PAVED))) builder->add_tag("surface", "paved");
+    if (parse_bool(get_field_from_feature(f, SF_BRIDGE))) builder->add_tag("bridge", YES);
+    if (parse_bool(get_field_from_feature(f, SF_TUNNEL))) builder->add_tag("tunnel", YES);
+    if (parse_bool(get_field_from_feature(f, SF_TOLLWAY))) builder->add_tag("toll", YES);
+    if (parse_bool(get_field_from_feature(f, SF_ROUNDABOUT))) builder->add_tag("junction", "roundabout");
+    if (parse_bool(get_field_from_feature(f, SF_FOURWHLDR))) builder->add_tag("4wd_only", YES);
 }
 
 /**
  * \brief maps navteq tags for access, tunnel, bridge, etc. to osm tags
  * \return link id of processed feature.
  */
-link_id_type parse_street_tags(osmium::builder::TagListBuilder *builder, ogr_feature_uptr& f, cdms_map_type* cdms_map =
-        nullptr, cnd_mod_map_type* cnd_mod_map = nullptr, area_id_govt_code_map_type* area_govt_map = nullptr,
+link_id_type parse_street_tags(osmium::builder::TagListBuilder *builder, ogr_feature_uptr& f,
+        const link_restrictions_index* restrictions = nullptr, area_id_govt_code_map_type* area_govt_map = nullptr,
         cntry_ref_map_type* cntry_map = nullptr) {
-    const char* link_id_s = get_field_from_feature(f, LINK_ID);
+    const char* link_id_s = get_field_from_feature(f, SF_LINK_ID);
     link_id_type link_id = std::stoul(link_id_s);
     builder->add_tag(LINK_ID, link_id_s); // tag for debug purpose
 
-    builder->add_tag("name", to_camel_case_with_spaces(get_field_from_feature(f, ST_NAME)).c_str());
-    if (is_ferry(get_field_from_feature(f, FERRY))) {
+    builder->add_tag("name", to_camel_case_with_spaces(get_field_from_feature(f, SF_ST_NAME)).c_str());
+    if (is_ferry(get_field_from_feature(f, SF_FERRY))) {
         add_ferry_tag(builder, f);
     } else {  // usual highways
-        add_highway_tags(builder, f, link_id, cdms_map, cnd_mod_map);
+        add_highway_tags(builder, f, link_id);
     }
 
-    area_id_type l_area_id = get_uint_from_feature(f, L_AREA_ID);
-    area_id_type r_area_id = get_uint_from_feature(f, R_AREA_ID);
+    area_id_type l_area_id = get_uint_from_feature(f, SF_L_AREA_ID);
+    area_id_type r_area_id = get_uint_from_feature(f, SF_R_AREA_ID);
     // tags which apply to highways and ferry routes
-    add_additional_restrictions(builder, link_id, l_area_id, r_area_id, cdms_map, cnd_mod_map, area_govt_map,
-            cntry_map);
+    add_additional_restrictions(builder, link_id, l_area_id, r_area_id, restrictions, area_govt_map, cntry_map);
     add_here_speed_cat_tag(builder, f);
-    if (parse_bool(get_field_from_feature(f, TOLLWAY))) builder->add_tag("here:tollway", YES);
-    if (parse_bool(get_field_from_feature(f, URBAN))) builder->add_tag("here:urban", YES);
-    std::string route_type = get_field_from_feature(f, ROUTE);
+    if (parse_bool(get_field_from_feature(f, SF_TOLLWAY))) builder->add_tag("here:tollway", YES);
+    if (parse_bool(get_field_from_feature(f, SF_URBAN))) builder->add_tag("here:urban", YES);
+    std::string route_type = get_field_from_feature(f, SF_ROUTE);
     if (!route_type.empty()) builder->add_tag("here:route_type", route_type.c_str());
 
-    std::string func_class = get_field_from_feature(f, FUNC_CLASS);
+    std::string func_class = get_field_from_feature(f, SF_FUNC_CLASS);
     if (!func_class.empty()) builder->add_tag("here:func_class", func_class.c_str());
 
 
@@ -14,6 +14,7 @@
 namespace {
 
 static const boost::filesystem::path STREETS_SHP = "Streets.shp";
+static const boost::filesystem::path STREETS_DBF = "Streets.dbf";
 static const boost::filesystem::path ADMINBNDY_1_SHP = "Adminbndy1.shp";
 static const boost::filesystem::path ADMINBNDY_2_SHP = "Adminbndy2.shp";
 static const boost::filesystem::path ADMINBNDY_3_SHP = "Adminbndy3.shp";
@@ -73,6 +74,25 @@ const char* R_AREA_ID = "R_AREA_ID";
 const char* L_POSTCODE = "L_POSTCODE";
 const char* R_POSTCODE = "R_POSTCODE";
 
+// STREETS columns which are read per feature. Their field indices are resolved once per layer.
+enum streets_field {
+    SF_LINK_ID, SF_ST_NAME, SF_ADDR_TYPE, SF_L_REFADDR, SF_L_NREFADDR, SF_L_ADDRSCH, SF_R_REFADDR,
+    SF_R_NREFADDR, SF_R_ADDRSCH, SF_FUNC_CLASS, SF_SPEED_CAT, SF_FR_SPEED_LIMIT, SF_TO_SPEED_LIMIT,
+    SF_DIR_TRAVEL, SF_AR_AUTO, SF_AR_BUS, SF_AR_TAXIS, SF_AR_PEDESTRIANS, SF_AR_TRUCKS, SF_AR_EMERVEH,
+    SF_AR_MOTORCYCLES, SF_AR_THROUGH_TRAFFIC, SF_PAVED, SF_PRIVATE, SF_BRIDGE, SF_TUNNEL, SF_TOLLWAY,
+    SF_ROUNDABOUT, SF_FERRY, SF_URBAN, SF_ROUTE, SF_FOURWHLDR, SF_PHYS_LANES, SF_PUB_ACCESS, SF_L_AREA_ID,
+    SF_R_AREA_ID, SF_L_POSTCODE, SF_R_POSTCODE, STREETS_FIELD_COUNT
+};
+
+// column names in the order of streets_field
+static const char* STREETS_FIELDS[STREETS_FIELD_COUNT] = {
+    LINK_ID, ST_NAME, ADDR_TYPE, L_REFADDR, L_NREFADDR, L_ADDRSCH, R_REFADDR, R_NREFADDR, R_ADDRSCH,
+    FUNC_CLASS, SPEED_CAT, FR_SPEED_LIMIT, TO_SPEED_LIMIT, DIR_TRAVEL, AR_AUTO, AR_BUS, AR_TAXIS,
+    AR_PEDESTRIANS, AR_TRUCKS, AR_EMERVEH, AR_MOTORCYCLES, AR_THROUGH_TRAFFIC, PAVED, PRIVATE, BRIDGE, TUNNEL,
+    TOLLWAY, ROUNDABOUT, FERRY, URBAN, ROUTE, FOURWHLDR, PHYS_LANES, PUB_ACCESS, L_AREA_ID, R_AREA_ID,
+    L_POSTCODE, R_POSTCODE
+};
+
 // MTD_AREA_DBF columns
 const char* AREA_ID = "AREA_ID";
 const char* LANG_CODE = "LANG_CODE";
@@ -5,6 +5,10 @@
  *      Author: philip
  */
 
+#include <sys/wait.h>
+#include <unistd.h>
+#include <map>
+
 #include <osmium/io/any_input.hpp>
 #include <osmium/io/any_output.hpp>
 
@@ -97,12 +101,24 @@ bool navteq_plugin::check_input(boost::filesystem::path input_path, boost::files
     return true;
 }
 
-void navteq_plugin::write_output() {
-    std::cout << "writing... " << output_path << std::endl;
-    osmium::io::File outfile(output_path.string());
+/**
+ * \brief directory of index and temporary files (--index-dir, default: temporary directory).
+ */
+boost::filesystem::path navteq_plugin::index_dir() const {
+    return options.index_dir.empty() ? boost::filesystem::temp_directory_path() : options.index_dir;
+}
+
+osmium::io::Header create_output_header() {
     osmium::io::Header hdr;
     hdr.set("generator", "osmium");
     hdr.set("xml_josm_upload", "false");
+    return hdr;
+}
+
+void navteq_plugin::write_output() {
+    std::cout << "writing... " << output_path << std::endl;
+    osmium::io::File outfile(output_path.string());
+    osmium::io::Header hdr = create_output_header();
     osmium::io::Writer writer(outfile, hdr, osmium::io::overwrite::allow);
     writer(std::move(g_node_buffer));
     writer(std::move(g_way_buffer));
@@ -110,34 +126,204 @@ void navteq_plugin::write_output() {
     writer.close();
 }
 
-void navteq_plugin::add_administrative_boundaries() {
+void navteq_plugin::add_administrative_boundaries(const path_vector_type& input_dirs) {
 
     // todo admin-levels only apply to the US => more generic for all countries
-    for (auto dir : dirs){
+    for (auto dir : input_dirs){
         process_meta_areas(dir);
     }
 
-    for (auto dir : dirs) {
-        if (shp_file_exists(dir / ADMINBNDY_1_SHP)) add_admin_shape(dir / ADMINBNDY_1_SHP);
-        if (shp_file_exists(dir / ADMINBNDY_2_SHP)) add_admin_shape(dir / ADMINBNDY_2_SHP);
-        if (shp_file_exists(dir / ADMINBNDY_3_SHP)) add_admin_shape(dir / ADMINBNDY_3_SHP);
-        if (shp_file_exists(dir / ADMINBNDY_4_SHP)) add_admin_shape(dir / ADMINBNDY_4_SHP);
-        if (shp_file_exists(dir / ADMINBNDY_5_SHP)) add_admin_shape(dir / ADMINBNDY_5_SHP);
+    path_vector_type admin_shape_files;
+    for (auto dir : input_dirs) {
+        if (shp_file_exists(dir / ADMINBNDY_1_SHP)) admin_shape_files.push_back(dir / ADMINBNDY_1_SHP);
+        if (shp_file_exists(dir / ADMINBNDY_2_SHP)) admin_shape_files.push_back(dir / ADMINBNDY_2_SHP);
+        if (shp_file_exists(dir / ADMINBNDY_3_SHP)) admin_shape_files.push_back(dir / ADMINBNDY_3_SHP);
+        if (shp_file_exists(dir / ADMINBNDY_4_SHP)) admin_shape_files.push_back(dir / ADMINBNDY_4_SHP);
+        if (shp_file_exists(dir / ADMINBNDY_5_SHP)) admin_shape_files.push_back(dir / ADMINBNDY_5_SHP);
     }
+    if (options.admin_topology)
+        add_admin_shapes_topology(admin_shape_files);
+    else
+        add_admin_shapes(admin_shape_files, false, options.threads);
     g_mtd_area_map.clear();
 }
 
-void navteq_plugin::execute() {
-
-    add_street_shapes(dirs);
+/**
+ * \brief converts streets, turn restrictions and administrative boundaries of input_dirs.
+ * \param end_points if set, receives the way end points before they are cleared.
+ */
+void navteq_plugin::convert(const path_vector_type& input_dirs, dir_end_point_vector* end_points) {
+    add_street_shapes(input_dirs, false, options.threads, options.stream_z_levels);
     assert__id_uniqueness();
+    if (end_points) *end_points = collect_end_points();
+    // turn restrictions take their via nodes from g_link_ways
+    g_way_end_points_map.clear();
+    g_z_lvl_nodes_map.clear();
 
-    add_turn_restrictions(dirs);
+    begin_phase("turn restrictions");
+    add_turn_restrictions(input_dirs);
+    end_phase();
     assert__id_uniqueness();
+    link_ways_vector_type().swap(g_link_ways);
+    g_cdms_map.clear();
+
+    begin_phase("administrative boundaries");
+    add_administrative_boundaries(input_dirs);
+    end_phase();
+}
 
-    add_administrative_boundaries();
+/**
+ * \brief converts directory dir_index of dirs in a child process, writes the result to tmp_dir and exits.
+ */
+void navteq_plugin::run_dir_pipeline(size_t dir_index, const boost::filesystem::path& tmp_dir) {
+    int status = 0;
+    try {
+        // the parent reports statistics of the pipelines as a whole, rows are passed with the result
+        conversion_stats stats;
+        g_stats = &stats;
+        osmium::unsigned_object_id_type first_id = dir_pipeline_first_id(dir_index, dirs.size());
+        g_osm_id = first_id;
+        set_node_index_backend(options.index_backend, index_dir());
+
+        dir_end_point_vector end_points;
+        convert(path_vector_type(1, dirs.at(dir_index)), &end_points);
+        if (g_osm_id > dir_pipeline_first_id(dir_index + 1, dirs.size()))
+            throw(std::runtime_error("too many objects for the id range of a directory"));
+        uint64_t rows = 0;
+        for (auto& phase : stats.get_phases())
+            rows += phase.rows;
+        g_stats = nullptr;
+        write_dir_pipeline_result(dir_pipeline_files(tmp_dir / std::to_string(dir_index)), first_id, end_points,
+                rows);
+    } catch (const std::exception& e) {
+        std::cerr << dirs.at(dir_index) << ": " << e.what() << std::endl;
+        status = 1;
+    } catch (...) {
+        // the child mustn't return into the driver loop of the parent
+        std::cerr << dirs.at(dir_index) << ": unknown error" << std::endl;
+        status = 1;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    // the copied state of the parent mustn't be cleaned up twice
+    _exit(status);
+}
 
-    if (!output_path.empty()) write_output();
+/**
+ * \brief converts every directory in a child process, at most options.processes at the same time.
+ *        Children are forked before the parent starts any threads.
+ */
+void navteq_plugin::run_dir_pipelines(const boost::filesystem::path& tmp_dir) {
+    std::map<pid_t, size_t> children;
+    std::string failed_dirs;
+    bool fork_failed = false;
+    size_t next_dir = 0;
+    while (!children.empty() || (next_dir < dirs.size() && !fork_failed)) {
+        if (next_dir < dirs.size() && !fork_failed && children.size() < options.processes) {
+            // buffered output would be written by parent and child
+            std::cout.flush();
+            std::cerr.flush();
+            pid_t pid = fork();
+            if (pid == 0) run_dir_pipeline(next_dir, tmp_dir);
+            if (pid == -1) fork_failed = true;
+            else children.insert(std::make_pair(pid, next_dir++));
+            continue;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid == -1) throw(std::runtime_error("waiting for directory pipelines failed"));
+        auto child = children.find(pid);
+        if (child == children.end()) continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed_dirs += " " + dirs.at(child->second).string();
+        children.erase(child);
+    }
+    if (fork_failed) throw(std::runtime_error("could not start process for " + dirs.at(next_dir).string()));
+    if (!failed_dirs.empty()) throw(std::runtime_error("conversion failed for" + failed_dirs));
+}
+
+/**
+ * \brief merges the results of the directory pipelines in the order of dirs.
+ *        Ways ending at the same location and z-level in different directories are connected.
+ *        Turn restrictions whose links lie in different directories are lost.
+ */
+void navteq_plugin::merge_dir_pipelines(const boost::filesystem::path& tmp_dir) {
+    z_lvl_nodes_map_type end_points;
+    end_points.set_backend(options.index_backend, index_dir());
+    for (size_t i = 0; i < dirs.size(); i++)
+        merge_dir_pipeline_result(dir_pipeline_files(tmp_dir / std::to_string(i)), end_points);
+}
+
+void navteq_plugin::execute() {
+
+    // statistics of the conversion phases
+    conversion_stats stats;
+    if (options.stats != stats_format::none) g_stats = &stats;
+
+    // with more than one process every directory is converted on its own and merged afterwards
+    bool dir_pipelines = options.processes > 1 && dirs.size() > 1;
+    boost::filesystem::path tmp_dir;
+    if (dir_pipelines) {
+        tmp_dir = index_dir() / boost::filesystem::unique_path("comm2osm-%%%%-%%%%-%%%%");
+        boost::filesystem::create_directory(tmp_dir);
+        begin_phase("directory pipelines");
+        try {
+            // children inherit the tables of all directories, so their tags match a single process
+            init_shared_reference_tables(dirs);
+            run_dir_pipelines(tmp_dir);
+            g_area_to_govt_code_map.clear();
+            g_cntry_ref_map.clear();
+            g_mtd_area_map.clear();
+            // cpu time of the children is taken from their rusage, rows and objects from their results
+            for (size_t i = 0; i < dirs.size(); i++) {
+                dir_pipeline_ids ids = read_dir_pipeline_ids(dir_pipeline_files(tmp_dir / std::to_string(i)));
+                count_rows(ids.rows);
+                count_objects(ids.end_id - ids.first_id);
+            }
+        } catch (...) {
+            boost::filesystem::remove_all(tmp_dir);
+            throw;
+        }
+        end_phase();
+    }
+
+    // streaming mode: objects are written while converting
+    std::unique_ptr<streaming_osm_writer> stream_writer;
+    if (options.stream_output && !output_path.empty()) {
+        std::cout << "writing... " << output_path << std::endl;
+        stream_writer.reset(new streaming_osm_writer(osmium::io::File(output_path.string()), create_output_header()));
+        g_osm_writer = stream_writer.get();
+    }
+
+    if (dir_pipelines) {
+        begin_phase("merge directories");
+        try {
+            merge_dir_pipelines(tmp_dir);
+        } catch (...) {
+            boost::filesystem::remove_all(tmp_dir);
+            throw;
+        }
+        boost::filesystem::remove_all(tmp_dir);
+        end_phase();
+    } else {
+        set_node_index_backend(options.index_backend, index_dir());
+        convert(dirs);
+    }
+
+    begin_phase("write");
+    if (stream_writer) {
+        stream_writer->close(g_node_buffer, g_way_buffer, g_rel_buffer);
+        g_osm_writer = nullptr;
+    } else if (!output_path.empty()) {
+        write_output();
+    }
+    end_phase();
+
+    if (g_stats) {
+        std::cerr << std::endl;
+        stats.write(std::cerr, options.stats);
+        g_stats = nullptr;
+    }
 
     std::cout << std::endl << "fin" << std::endl;
 }
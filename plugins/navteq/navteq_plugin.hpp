@@ -19,7 +19,12 @@ private:
     void recurse_dir(boost::filesystem::path dir);
     bool check_files(boost::filesystem::path dir);
     void write_output();
-    void add_administrative_boundaries();
+    boost::filesystem::path index_dir() const;
+    void add_administrative_boundaries(const path_vector_type& input_dirs);
+    void convert(const path_vector_type& input_dirs, dir_end_point_vector* end_points = nullptr);
+    void run_dir_pipeline(size_t dir_index, const boost::filesystem::path& tmp_dir);
+    void run_dir_pipelines(const boost::filesystem::path& tmp_dir);
+    void merge_dir_pipelines(const boost::filesystem::path& tmp_dir);
 
     path_vector_type dirs;
 
@@ -8,13 +8,19 @@
 #ifndef PLUGINS_NAVTEQ_NAVTEQ_TYPES_HPP_
 #define PLUGINS_NAVTEQ_NAVTEQ_TYPES_HPP_
 
-#include <unordered_map>
-#include <osmium/index/map/sparse_mem_array.hpp>
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
 #include <osmium/osm/location.hpp>
+#include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/types.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include "ogr_types.hpp"
+#include "../location_index.hpp"
 
 typedef std::vector<boost::filesystem::path> path_vector_type;
 
@@ -62,14 +68,263 @@ typedef uint64_t govt_code_type;
 typedef std::map<area_id_type, govt_code_type> area_id_govt_code_map_type;
 typedef std::map<govt_code_type, cntry_ref_type> cntry_ref_map_type;
 
-typedef std::unordered_map<cond_id_type, mod_group_type> cnd_mod_map_type;
+// rows of CndMod.dbf as pairs of [cond_id, mod_group]
+typedef std::vector<std::pair<cond_id_type, mod_group_type>> cnd_mod_vector_type;
 
 typedef uint64_t link_id_type;
-typedef std::multimap<link_id_type, cond_id_type> cdms_map_type;
+typedef ushort cond_type_type;
+
+/**
+ * \brief Conditions of Cdms.dbf in sorted flat arrays, read once and shared by the tags of
+ *        streets (conditions of a link) and the turn restrictions (types of conditions).
+ *        Rows are added while reading, sort() has to be called before any lookup.
+ */
+class cdms_index {
+    // conditions of links, sorted by link id. the conditions of a link are contiguous.
+    std::vector<link_id_type> link_ids;
+    std::vector<cond_id_type> link_cond_ids;
+    // types of conditions, sorted by condition id
+    std::vector<cond_id_type> cond_ids;
+    std::vector<cond_type_type> cond_types;
+    bool sorted = true;
+
+    // sorts keys and values by keys. values of equal keys keep their order.
+    template <class TKey, class TValue>
+    static void sort_by_key(std::vector<TKey>& keys, std::vector<TValue>& values) {
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) {return keys[lhs] < keys[rhs];});
+        std::vector<TKey> sorted_keys;
+        std::vector<TValue> sorted_values;
+        sorted_keys.reserve(keys.size());
+        sorted_values.reserve(values.size());
+        for (size_t i : order) {
+            sorted_keys.push_back(keys[i]);
+            sorted_values.push_back(values[i]);
+        }
+        keys.swap(sorted_keys);
+        values.swap(sorted_values);
+    }
+
+public:
+    /**
+     * \brief condition ids of a link.
+     */
+    class cond_id_range {
+        const cond_id_type* first;
+        const cond_id_type* last;
+
+    public:
+        cond_id_range(const cond_id_type* first, const cond_id_type* last) :
+                first(first), last(last) {
+        }
+
+        const cond_id_type* begin() const {
+            return first;
+        }
+
+        const cond_id_type* end() const {
+            return last;
+        }
+
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+    /**
+     * \brief adds a row of Cdms.dbf.
+     */
+    void add(link_id_type link_id, cond_id_type cond_id, cond_type_type cond_type) {
+        link_ids.push_back(link_id);
+        link_cond_ids.push_back(cond_id);
+        cond_ids.push_back(cond_id);
+        cond_types.push_back(cond_type);
+        sorted = false;
+    }
+
+    /**
+     * \brief sorts the added rows. A condition has a single type, the first row of a condition id wins.
+     */
+    void sort() {
+        sort_by_key(link_ids, link_cond_ids);
+        sort_by_key(cond_ids, cond_types);
+        size_t count = 0;
+        for (size_t i = 0; i < cond_ids.size(); i++) {
+            if (count > 0 && cond_ids[count - 1] == cond_ids[i]) continue;
+            cond_ids[count] = cond_ids[i];
+            cond_types[count] = cond_types[i];
+            count++;
+        }
+        cond_ids.resize(count);
+        cond_types.resize(count);
+        cond_ids.shrink_to_fit();
+        cond_types.shrink_to_fit();
+        sorted = true;
+    }
+
+    /**
+     * \return ids of the conditions of link_id in the order of Cdms.dbf.
+     */
+    cond_id_range conditions(link_id_type link_id) const {
+        assert(sorted);
+        auto range = std::equal_range(link_ids.cbegin(), link_ids.cend(), link_id);
+        const cond_id_type* first = link_cond_ids.data() + (range.first - link_ids.cbegin());
+        return cond_id_range(first, first + (range.second - range.first));
+    }
+
+    /**
+     * \return pointer to the type of condition cond_id or nullptr if it isn't in Cdms.dbf.
+     */
+    const cond_type_type* find_cond_type(cond_id_type cond_id) const {
+        assert(sorted);
+        auto it = std::lower_bound(cond_ids.cbegin(), cond_ids.cend(), cond_id);
+        if (it == cond_ids.cend() || *it != cond_id) return nullptr;
+        return &cond_types[it - cond_ids.cbegin()];
+    }
+
+    // number of rows
+    size_t size() const {
+        return link_ids.size();
+    }
+
+    /**
+     * \brief calls func(link_id, cond_id) for all rows.
+     */
+    template <class TFunction>
+    void for_each_condition(TFunction func) const {
+        for (size_t i = 0; i < link_ids.size(); i++)
+            func(link_ids[i], link_cond_ids[i]);
+    }
+
+    void clear() {
+        std::vector<link_id_type>().swap(link_ids);
+        std::vector<cond_id_type>().swap(link_cond_ids);
+        std::vector<cond_id_type>().swap(cond_ids);
+        std::vector<cond_type_type>().swap(cond_types);
+        sorted = true;
+    }
+};
+
+typedef cdms_index cdms_map_type;
+
+/**
+ * \brief smallest dimension and weight restrictions of a link in the units of CndMod.dbf.
+ *        A value is only valid if its bit is set in present.
+ */
+struct link_restrictions_type {
+    enum restriction {
+        height, width, length, weight, axleload, restriction_count
+    };
+
+    uint8_t present;
+    mod_val_type values[restriction_count];
+
+    bool has(restriction r) const {
+        return present & (1 << r);
+    }
+
+    /**
+     * \brief lowers restriction r to value. Zero isn't a restriction.
+     */
+    void restrict(restriction r, mod_val_type value) {
+        if (value == 0) return;
+        if (!has(r) || value < values[r]) values[r] = value;
+        present |= 1 << r;
+    }
+};
+
+/**
+ * \brief Restrictions of links sorted by link id. Only links with restrictions are stored.
+ */
+class link_restrictions_index {
+    std::vector<link_id_type> link_ids;
+    std::vector<link_restrictions_type> restrictions;
+
+public:
+    /**
+     * \brief adds restriction r of link_id. Links have to be added in ascending order.
+     */
+    void add(link_id_type link_id, link_restrictions_type::restriction r, mod_val_type value) {
+        assert(link_ids.empty() || link_ids.back() <= link_id);
+        if (link_ids.empty() || link_ids.back() != link_id) {
+            link_ids.push_back(link_id);
+            restrictions.push_back(link_restrictions_type { 0, { } });
+        }
+        restrictions.back().restrict(r, value);
+    }
+
+    /**
+     * \return restrictions of link_id or nullptr if it has none.
+     */
+    const link_restrictions_type* find(link_id_type link_id) const {
+        auto it = std::lower_bound(link_ids.cbegin(), link_ids.cend(), link_id);
+        if (it == link_ids.cend() || *it != link_id) return nullptr;
+        return &restrictions[it - link_ids.cbegin()];
+    }
+
+    size_t size() const {
+        return link_ids.size();
+    }
+
+    void clear() {
+        link_ids.clear();
+        restrictions.clear();
+    }
+};
 
 // vector of osm_ids
 typedef std::vector<osmium::unsigned_object_id_type> osm_id_vector_type;
 
+typedef std::vector<osmium::NodeRef> node_ref_vector_type;
+
+/**
+ * \brief View on consecutive NodeRefs, e.g. the Nodes of a sub way of a link. Doesn't own the NodeRefs.
+ */
+class node_ref_span {
+    const osmium::NodeRef* node_refs;
+    size_t num_node_refs;
+
+public:
+    node_ref_span(const osmium::NodeRef* node_refs = nullptr, size_t num_node_refs = 0) :
+            node_refs(node_refs), num_node_refs(num_node_refs) {
+    }
+
+    explicit node_ref_span(const node_ref_vector_type& vector) :
+            node_refs(vector.data()), num_node_refs(vector.size()) {
+    }
+
+    size_t size() const {
+        return num_node_refs;
+    }
+
+    const osmium::NodeRef* begin() const {
+        return node_refs;
+    }
+
+    const osmium::NodeRef* end() const {
+        return node_refs + num_node_refs;
+    }
+
+    const osmium::NodeRef& front() const {
+        assert(num_node_refs > 0);
+        return node_refs[0];
+    }
+
+    const osmium::NodeRef& back() const {
+        assert(num_node_refs > 0);
+        return node_refs[num_node_refs - 1];
+    }
+
+    /**
+     * \brief returns the NodeRefs [start_index, end_index] inclusive.
+     */
+    node_ref_span sub(size_t start_index, size_t end_index) const {
+        assert(start_index < end_index && end_index < num_node_refs);
+        return node_ref_span(node_refs + start_index, end_index - start_index + 1);
+    }
+};
+
 // maps location to node ids
 typedef std::map<osmium::Location, osmium::unsigned_object_id_type> node_map_type;
 
@@ -78,23 +333,218 @@ typedef std::pair<osmium::Location, osmium::unsigned_object_id_type> loc_osmid_p
 // vector of pairs of [Location, osm_id]
 typedef std::vector<loc_osmid_pair_type> node_vector_type;
 
-// maps link ids to a vector of osm_ids
-typedef std::map<link_id_type, osm_id_vector_type> link_id_map_type;
-
 typedef std::vector<link_id_type> link_id_vector_type;
 
+/**
+ * \brief ways and end nodes of a link. The ways of a link have consecutive ids
+ *        [first_way_id, last_way_id] and run from front to back.
+ */
+struct link_ways_type {
+    link_id_type link_id;
+    osmium::unsigned_object_id_type first_way_id;
+    osmium::unsigned_object_id_type last_way_id;
+    // first node of the first way
+    osmium::NodeRef front;
+    // last node of the last way
+    osmium::NodeRef back;
+};
+
+// ways of all links, sorted by link_id for lookups
+typedef std::vector<link_ways_type> link_ways_vector_type;
+
 /* z-level types */
 // type of z-levels (range -4 to +5)
 typedef short z_lvl_type;
 
 typedef std::pair<ushort, z_lvl_type> index_z_lvl_pair_type;
 typedef std::vector<index_z_lvl_pair_type> index_z_lvl_vector_type;
-// maps navteq link_ids to pairs of <index, z_lvl>
-typedef std::map<link_id_type, index_z_lvl_vector_type> z_lvl_map;
 
-// pair [Location, z_level] identifies nodes precisely
-typedef std::pair<osmium::Location, z_lvl_type> node_id_type;
-// maps pair [Location, z_level] to osm_id.
-typedef std::map<node_id_type, osmium::unsigned_object_id_type> z_lvl_nodes_map_type;
+/**
+ * \brief [index, z_lvl] pairs of a link, sorted by index. Refers to the pairs of a z_lvl_index
+ *        or an index_z_lvl_vector_type, which must outlive the range.
+ */
+class z_lvl_range {
+    const index_z_lvl_pair_type* first;
+    const index_z_lvl_pair_type* last;
+
+public:
+    typedef const index_z_lvl_pair_type* const_iterator;
+
+    z_lvl_range() :
+            first(nullptr), last(nullptr) {
+    }
+
+    z_lvl_range(const index_z_lvl_pair_type* first, const index_z_lvl_pair_type* last) :
+            first(first), last(last) {
+    }
+
+    z_lvl_range(const index_z_lvl_vector_type& vector) :
+            first(vector.data()), last(vector.data() + vector.size()) {
+    }
+
+    const_iterator begin() const {
+        return first;
+    }
+
+    const_iterator end() const {
+        return last;
+    }
+
+    const_iterator cbegin() const {
+        return first;
+    }
+
+    const_iterator cend() const {
+        return last;
+    }
+
+    size_t size() const {
+        return last - first;
+    }
+
+    bool empty() const {
+        return first == last;
+    }
+
+    const index_z_lvl_pair_type& at(size_t i) const {
+        if (i >= size()) throw std::out_of_range("z_lvl_range::at");
+        return first[i];
+    }
+};
+
+/**
+ * \brief Maps link ids to their [index, z_lvl] pairs in compressed sparse row layout: sorted link ids,
+ *        offsets of their pairs and one array of all pairs. Only links with z-levels are stored.
+ *
+ *        Most links have no z-levels. A bitmap of hashed link ids answers most lookups of those
+ *        without the binary search. Links are added while reading, sort() has to be called
+ *        before any lookup. Concurrent lookups are safe.
+ */
+class z_lvl_index {
+    std::vector<link_id_type> link_ids;
+    // pairs of link_ids[i] are z_lvls[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> offsets { 0 };
+    std::vector<index_z_lvl_pair_type> z_lvls;
+    // bit hash(link_id) & filter_mask is set for every stored link
+    std::vector<uint64_t> filter;
+    uint64_t filter_mask = 0;
+    bool sorted = true;
+
+    // consecutive link ids set bits all over the filter
+    static uint64_t hash(uint64_t key) {
+        return mix64(key);
+    }
+
+    bool may_contain(link_id_type link_id) const {
+        uint64_t bit = hash(link_id) & filter_mask;
+        return filter[bit / 64] & (uint64_t(1) << (bit % 64));
+    }
+
+    // builds the filter with at least 16 bits per link, about 6% false positives
+    void build_filter() {
+        uint64_t bits = 64;
+        while (bits < 16 * link_ids.size())
+            bits <<= 1;
+        std::vector<uint64_t>(bits / 64).swap(filter);
+        filter_mask = bits - 1;
+        for (link_id_type link_id : link_ids) {
+            uint64_t bit = hash(link_id) & filter_mask;
+            filter[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+public:
+    z_lvl_index() {
+        build_filter();
+    }
+
+    /**
+     * \brief adds the pairs [first, last) of link_id. Empty ranges are ignored.
+     */
+    void add(link_id_type link_id, const index_z_lvl_pair_type* first, const index_z_lvl_pair_type* last) {
+        if (first == last) return;
+        if (!link_ids.empty() && link_ids.back() >= link_id) sorted = false;
+        link_ids.push_back(link_id);
+        z_lvls.insert(z_lvls.end(), first, last);
+        if (z_lvls.size() > std::numeric_limits<uint32_t>::max()) throw std::length_error("z_lvl_index::add");
+        offsets.push_back(z_lvls.size());
+    }
+
+    void add(link_id_type link_id, const index_z_lvl_vector_type& vector) {
+        add(link_id, vector.data(), vector.data() + vector.size());
+    }
+
+    /**
+     * \brief sorts the links and builds the filter. Like std::map::insert, the first
+     *        pairs added for a link id win.
+     */
+    void sort() {
+        if (!sorted) {
+            std::vector<size_t> order(link_ids.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                    [this](size_t lhs, size_t rhs) {return link_ids[lhs] < link_ids[rhs];});
+            std::vector<link_id_type> sorted_link_ids;
+            std::vector<uint32_t> sorted_offsets { 0 };
+            std::vector<index_z_lvl_pair_type> sorted_z_lvls;
+            sorted_link_ids.reserve(link_ids.size());
+            sorted_offsets.reserve(offsets.size());
+            sorted_z_lvls.reserve(z_lvls.size());
+            for (size_t i : order) {
+                if (!sorted_link_ids.empty() && sorted_link_ids.back() == link_ids[i]) continue;
+                sorted_link_ids.push_back(link_ids[i]);
+                sorted_z_lvls.insert(sorted_z_lvls.end(), z_lvls.cbegin() + offsets[i], z_lvls.cbegin() + offsets[i + 1]);
+                sorted_offsets.push_back(sorted_z_lvls.size());
+            }
+            link_ids.swap(sorted_link_ids);
+            offsets.swap(sorted_offsets);
+            z_lvls.swap(sorted_z_lvls);
+        }
+        link_ids.shrink_to_fit();
+        offsets.shrink_to_fit();
+        z_lvls.shrink_to_fit();
+        build_filter();
+        sorted = true;
+    }
+
+    /**
+     * \return pairs of link_id or an empty range if it has no z-levels.
+     */
+    z_lvl_range find(link_id_type link_id) const {
+        assert(sorted);
+        if (!may_contain(link_id)) return z_lvl_range();
+        auto it = std::lower_bound(link_ids.cbegin(), link_ids.cend(), link_id);
+        if (it == link_ids.cend() || *it != link_id) return z_lvl_range();
+        size_t i = it - link_ids.cbegin();
+        return z_lvl_range(z_lvls.data() + offsets[i], z_lvls.data() + offsets[i + 1]);
+    }
+
+    // number of links with z-levels
+    size_t size() const {
+        return link_ids.size();
+    }
+
+    void clear() {
+        std::vector<link_id_type>().swap(link_ids);
+        std::vector<uint32_t>(1, 0).swap(offsets);
+        std::vector<index_z_lvl_pair_type>().swap(z_lvls);
+        sorted = true;
+        build_filter();
+    }
+};
+
+// maps pair [Location, z_level] to osm_id. The pair identifies nodes precisely.
+typedef location_level_id_index z_lvl_nodes_map_type;
+
+/**
+ * \brief way end point of a directory converted in its own process.
+ *        End points of different directories with equal location and z-level are joined.
+ */
+struct dir_end_point {
+    osmium::Location location;
+    z_lvl_type z_lvl;
+    osmium::unsigned_object_id_type id;
+};
+typedef std::vector<dir_end_point> dir_end_point_vector;
 
 #endif /* PLUGINS_NAVTEQ_NAVTEQ_TYPES_HPP_ */
@@ -11,6 +11,27 @@
 #include <assert.h>
 #include "../util.hpp"
 #include "navteq_types.hpp"
+#include "navteq_mappings.hpp"
+
+// field indices of the Streets layer which is processed by the current thread
+thread_local ogr_field_binding g_streets_binding;
+
+/**
+ * \brief resolves the field indices of all STREETS columns for features of defn.
+ *        throws format_error if a column is missing.
+ */
+void bind_streets_defn(OGRFeatureDefn* defn) {
+    g_streets_binding = ogr_field_binding(defn, STREETS_FIELDS, STREETS_FIELD_COUNT);
+}
+
+/**
+ * \brief resolves the field indices of all STREETS columns for layer.
+ *        has to be called before reading features of layer by streets_field.
+ *        throws format_error if a column is missing.
+ */
+void bind_streets_layer(OGRLayer* layer) {
+    bind_streets_defn(layer->GetLayerDefn());
+}
 
 /**
  * \brief returns field from OGRFeature
@@ -47,6 +68,37 @@ uint64_t get_uint_from_feature(std::unique_ptr<T>& feat, const char* field) {
     }
 }
 
+/**
+ * \brief returns STREETS field from OGRFeature by its prebound index
+ * \param feat feature from which field is read. its layer has to be bound with bind_streets_layer()
+ * \param field STREETS column
+ * \return const char* of field value
+ */
+template <class T>
+const char* get_field_from_feature(std::unique_ptr<T>& feat, streets_field field) {
+    assert(feat);
+    assert(g_streets_binding.is_bound_to(feat->GetDefnRef()));
+    return feat->GetFieldAsString(g_streets_binding[field]);
+}
 
+/**
+ * \brief returns STREETS field from OGRFeature by its prebound index
+ *        throws exception if field_value is not an uint
+ * \param feat feature from which field is read
+ * \param field STREETS column
+ * \return field value as uint
+ */
+template <class T>
+uint64_t get_uint_from_feature(std::unique_ptr<T>& feat, streets_field field) {
+    const char* value = get_field_from_feature(feat, field);
+    assert(value);
+    try {
+        return std::stoul(value);
+    } catch (const std::invalid_argument &) {
+        throw format_error(
+                "Could not parse field='" + std::string(STREETS_FIELDS[field]) + "' with value='" + std::string(value)
+                        + "'");
+    }
+}
 
 #endif /* PLUGINS_NAVTEQ_NAVTEQ_UTIL_HPP_ */
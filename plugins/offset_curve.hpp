@@ -0,0 +1,407 @@
+/*
+ * offset_curve.hpp
+ *
+ * Single sided offset curves of polylines without GEOS.
+ */
+
+#ifndef PLUGINS_OFFSET_CURVE_HPP_
+#define PLUGINS_OFFSET_CURVE_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "readers.hpp"
+
+/**
+ * \brief Builds single sided offset curves of polylines like OffsetCurveBuilder::getSingleSidedLineCurve()
+ *        of GEOS with default BufferParameters (8 quadrant segments, round joins).
+ *
+ *        The steps of GEOS are followed closely (simplification of the input line, offset segments,
+ *        fillets of outside turns, intersections of inside turns), so the curves match those of GEOS
+ *        up to rounding. Coordinates are kept in flat arrays [x0, y0, x1, y1, ...], the builder can be
+ *        reused to avoid allocations.
+ */
+class offset_curve_builder {
+    struct point {
+        double x;
+        double y;
+
+        bool operator==(const point& other) const {
+            return x == other.x && y == other.y;
+        }
+
+        double distance(const point& other) const {
+            double dx = x - other.x;
+            double dy = y - other.y;
+            return std::sqrt(dx * dx + dy * dy);
+        }
+    };
+
+    struct segment {
+        point p0;
+        point p1;
+    };
+
+    enum orientation_type {
+        clockwise = -1, collinear = 0, counterclockwise = 1
+    };
+
+    static constexpr double pi = 3.14159265358979323846;
+    static constexpr int quadrant_segments = 8;
+    static constexpr double simplify_factor = 0.01;
+    static constexpr double curve_vertex_snap_distance_factor = 1.0E-6;
+    static constexpr double offset_segment_separation_factor = 1.0E-3;
+    static constexpr double inside_turn_vertex_snap_distance_factor = 1.0E-3;
+    static constexpr double closing_segment_length_factor = 80;
+    static constexpr unsigned int simplifier_points_to_check = 10;
+
+    double distance;
+    // orientation of concavities on the offset side, which are removed by simplify()
+    orientation_type side;
+    point s0, s1, s2;
+    segment offset0, offset1;
+    std::vector<point> input;
+    std::vector<point> simplified;
+    std::vector<bool> deleted;
+    std::vector<point> curve;
+
+    /**
+     * \brief sign of the determinant dx1 * dy2 - dy1 * dx2. The rounding errors of the products are
+     *        taken into account, so the sign is exact like with RobustDeterminant of GEOS.
+     */
+    static int orientation(const point& p1, const point& p2, const point& q) {
+        double dx1 = p2.x - p1.x, dy1 = p2.y - p1.y;
+        double dx2 = q.x - p2.x, dy2 = q.y - p2.y;
+        double left = dx1 * dy2, right = dy1 * dx2;
+        double det = (left - right) + (std::fma(dx1, dy2, -left) - std::fma(dy1, dx2, -right));
+        return (det > 0) - (det < 0);
+    }
+
+    static bool in_envelope(const point& p, const point& a, const point& b) {
+        return p.x >= std::min(a.x, b.x) && p.x <= std::max(a.x, b.x) && p.y >= std::min(a.y, b.y)
+                && p.y <= std::max(a.y, b.y);
+    }
+
+    static bool envelopes_intersect(const point& p1, const point& p2, const point& q1, const point& q2) {
+        return std::min(q1.x, q2.x) <= std::max(p1.x, p2.x) && std::max(q1.x, q2.x) >= std::min(p1.x, p2.x)
+                && std::min(q1.y, q2.y) <= std::max(p1.y, p2.y) && std::max(q1.y, q2.y) >= std::min(p1.y, p2.y);
+    }
+
+    static double distance_point_line(const point& p, const point& a, const point& b) {
+        if (a == b) return p.distance(a);
+        double len2 = (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
+        double r = ((p.x - a.x) * (b.x - a.x) + (p.y - a.y) * (b.y - a.y)) / len2;
+        if (r <= 0.0) return p.distance(a);
+        if (r >= 1.0) return p.distance(b);
+        double s = ((a.y - p.y) * (b.x - a.x) - (a.x - p.x) * (b.y - a.y)) / len2;
+        return std::fabs(s) * std::sqrt(len2);
+    }
+
+    // endpoint closest to the centre of all endpoints, fallback for nearly parallel segments
+    static point central_endpoint(const point& p1, const point& p2, const point& q1, const point& q2) {
+        point pts[] = { p1, p2, q1, q2 };
+        point centre { (p1.x + p2.x + q1.x + q2.x) / 4, (p1.y + p2.y + q1.y + q2.y) / 4 };
+        point nearest = pts[0];
+        for (auto& pt : pts)
+            if (pt.distance(centre) < nearest.distance(centre)) nearest = pt;
+        return nearest;
+    }
+
+    /**
+     * \brief intersection of the lines through two segments with properly intersecting interiors.
+     *        Coordinates are translated to the centre of the intersection of the segment envelopes
+     *        first to preserve precision.
+     */
+    static point intersection(const point& p1, const point& p2, const point& q1, const point& q2) {
+        double min_x = std::max(std::min(p1.x, p2.x), std::min(q1.x, q2.x));
+        double max_x = std::min(std::max(p1.x, p2.x), std::max(q1.x, q2.x));
+        double min_y = std::max(std::min(p1.y, p2.y), std::min(q1.y, q2.y));
+        double max_y = std::min(std::max(p1.y, p2.y), std::max(q1.y, q2.y));
+        point centre { (min_x + max_x) / 2.0, (min_y + max_y) / 2.0 };
+        point n1 { p1.x - centre.x, p1.y - centre.y }, n2 { p2.x - centre.x, p2.y - centre.y };
+        point n3 { q1.x - centre.x, q1.y - centre.y }, n4 { q2.x - centre.x, q2.y - centre.y };
+
+        double px = n1.y - n2.y, py = n2.x - n1.x, pw = n1.x * n2.y - n2.x * n1.y;
+        double qx = n3.y - n4.y, qy = n4.x - n3.x, qw = n3.x * n4.y - n4.x * n3.y;
+        double w = px * qy - qx * py;
+        point pt { (py * qw - qy * pw) / w + centre.x, (qx * pw - px * qw) / w + centre.y };
+        if (!std::isfinite(pt.x) || !std::isfinite(pt.y) || !in_envelope(pt, p1, p2) || !in_envelope(pt, q1, q2))
+            return central_endpoint(p1, p2, q1, q2);
+        return pt;
+    }
+
+    /**
+     * \brief intersection point of two segments like RobustLineIntersector of GEOS.
+     * \return false if the segments don't intersect.
+     */
+    static bool intersect(const point& p1, const point& p2, const point& q1, const point& q2, point& pt) {
+        if (!envelopes_intersect(p1, p2, q1, q2)) return false;
+        int pq1 = orientation(p1, p2, q1), pq2 = orientation(p1, p2, q2);
+        if ((pq1 > 0 && pq2 > 0) || (pq1 < 0 && pq2 < 0)) return false;
+        int qp1 = orientation(q1, q2, p1), qp2 = orientation(q1, q2, p2);
+        if ((qp1 > 0 && qp2 > 0) || (qp1 < 0 && qp2 < 0)) return false;
+
+        if (pq1 == 0 && pq2 == 0 && qp1 == 0 && qp2 == 0) {
+            // collinear overlap, only possible for degenerated inside turns
+            pt = in_envelope(q1, p1, p2) ? q1 : p1;
+        } else if (pq1 == 0 || pq2 == 0 || qp1 == 0 || qp2 == 0) {
+            if (p1 == q1 || p1 == q2) pt = p1;
+            else if (p2 == q1 || p2 == q2) pt = p2;
+            else if (pq1 == 0) pt = q1;
+            else if (pq2 == 0) pt = q2;
+            else if (qp1 == 0) pt = p1;
+            else pt = p2;
+        } else {
+            pt = intersection(p1, p2, q1, q2);
+        }
+        return true;
+    }
+
+    /* simplification of the input line like BufferInputLineSimplifier of GEOS */
+
+    size_t next_not_deleted(size_t index) const {
+        size_t next = index + 1;
+        while (next < input.size() && deleted[next])
+            next++;
+        return next;
+    }
+
+    bool is_shallow(const point& p0, const point& p1, const point& p2, double tolerance) const {
+        return distance_point_line(p1, p0, p2) < tolerance;
+    }
+
+    // GEOS passes the middle vertex as p2 and samples the vertices between i0 and i2
+    bool is_shallow_sampled(const point& p0, const point& p2, size_t i0, size_t i2, double tolerance) const {
+        size_t increment = std::max((i2 - i0) / simplifier_points_to_check, size_t(1));
+        for (size_t i = i0; i < i2; i += increment)
+            if (!is_shallow(p0, p2, input[i], tolerance)) return false;
+        return true;
+    }
+
+    bool is_deletable(size_t i0, size_t i1, size_t i2, double tolerance, int concave_orientation) const {
+        const point& p0 = input[i0];
+        const point& p1 = input[i1];
+        const point& p2 = input[i2];
+        if (orientation(p0, p1, p2) != concave_orientation) return false;
+        if (!is_shallow(p0, p1, p2, tolerance)) return false;
+        return is_shallow_sampled(p0, p1, i0, i2, tolerance);
+    }
+
+    bool delete_shallow_concavities(double tolerance, int concave_orientation) {
+        // the first and the last segment aren't simplified
+        size_t index = 1;
+        size_t middle_index = next_not_deleted(index);
+        size_t last_index = next_not_deleted(middle_index);
+        bool changed = false;
+        while (last_index < input.size()) {
+            bool middle_deleted = false;
+            if (is_deletable(index, middle_index, last_index, tolerance, concave_orientation)) {
+                deleted[middle_index] = true;
+                middle_deleted = true;
+                changed = true;
+            }
+            index = middle_deleted ? last_index : middle_index;
+            middle_index = next_not_deleted(index);
+            last_index = next_not_deleted(middle_index);
+        }
+        return changed;
+    }
+
+    /**
+     * \brief removes shallow concavities on the offset side and repeated points of input.
+     */
+    void simplify(double tolerance) {
+        int concave_orientation = side == counterclockwise ? counterclockwise : clockwise;
+        deleted.assign(input.size(), false);
+        while (delete_shallow_concavities(tolerance, concave_orientation))
+            ;
+        simplified.clear();
+        for (size_t i = 0; i < input.size(); i++)
+            if (!deleted[i] && (simplified.empty() || !(simplified.back() == input[i])))
+                simplified.push_back(input[i]);
+    }
+
+    /* offset segments like OffsetSegmentGenerator of GEOS */
+
+    void add_point(const point& pt) {
+        // don't add duplicate (or near-duplicate) points
+        if (!curve.empty() && pt.distance(curve.back()) < distance * curve_vertex_snap_distance_factor) return;
+        curve.push_back(pt);
+    }
+
+    // offset segments are always on the left side, the right side is built on the reversed line
+    void compute_offset_segment(const point& p0, const point& p1, segment& offset) const {
+        double dx = p1.x - p0.x;
+        double dy = p1.y - p0.y;
+        double len = std::sqrt(dx * dx + dy * dy);
+        double ux = distance * dx / len;
+        double uy = distance * dy / len;
+        offset.p0 = point { p0.x - uy, p0.y + ux };
+        offset.p1 = point { p1.x - uy, p1.y + ux };
+    }
+
+    void add_fillet(const point& p, double start_angle, double end_angle, int direction) {
+        static const double fillet_angle_quantum = pi / 2.0 / quadrant_segments;
+        int direction_factor = direction == clockwise ? -1 : 1;
+        double total_angle = std::fabs(start_angle - end_angle);
+        int segments = int(total_angle / fillet_angle_quantum + 0.5);
+        if (segments < 1) return;
+        double angle_increment = total_angle / segments;
+        for (double angle = 0.0; angle < total_angle; angle += angle_increment) {
+            double a = start_angle + direction_factor * angle;
+            add_point(point { p.x + distance * std::cos(a), p.y + distance * std::sin(a) });
+        }
+    }
+
+    void add_fillet(const point& p, const point& p0, const point& p1, int direction) {
+        double start_angle = std::atan2(p0.y - p.y, p0.x - p.x);
+        double end_angle = std::atan2(p1.y - p.y, p1.x - p.x);
+        if (direction == clockwise) {
+            if (start_angle <= end_angle) start_angle += 2.0 * pi;
+        } else {
+            if (start_angle >= end_angle) start_angle -= 2.0 * pi;
+        }
+        add_point(p0);
+        add_fillet(p, start_angle, end_angle, direction);
+        add_point(p1);
+    }
+
+    void add_collinear() {
+        // only a reversal of the line needs a join
+        if (in_envelope(s2, s0, s1) || in_envelope(s0, s1, s2)) add_fillet(s1, offset0.p1, offset1.p0, clockwise);
+    }
+
+    void add_outside_turn(int orientation) {
+        if (offset0.p1.distance(offset1.p0) < distance * offset_segment_separation_factor) {
+            add_point(offset0.p1);
+            return;
+        }
+        add_point(offset0.p1);
+        add_fillet(s1, offset0.p1, offset1.p0, orientation);
+        add_point(offset1.p0);
+    }
+
+    void add_inside_turn() {
+        point pt;
+        if (intersect(offset0.p0, offset0.p1, offset1.p0, offset1.p1, pt)) {
+            add_point(pt);
+        } else if (offset0.p1.distance(offset1.p0) < distance * inside_turn_vertex_snap_distance_factor) {
+            add_point(offset0.p1);
+        } else {
+            // narrow concave angle, the offset segments are closed by two short segments close to s1
+            const double f = closing_segment_length_factor;
+            add_point(offset0.p1);
+            add_point(point { (f * offset0.p1.x + s1.x) / (f + 1), (f * offset0.p1.y + s1.y) / (f + 1) });
+            add_point(point { (f * offset1.p0.x + s1.x) / (f + 1), (f * offset1.p0.y + s1.y) / (f + 1) });
+            add_point(offset1.p0);
+        }
+    }
+
+    void add_next_segment(const point& p) {
+        s0 = s1;
+        s1 = s2;
+        s2 = p;
+        compute_offset_segment(s0, s1, offset0);
+        compute_offset_segment(s1, s2, offset1);
+        if (s1 == s2) return;
+        int turn = orientation(s0, s1, s2);
+        if (turn == collinear) add_collinear();
+        else if (turn == clockwise) add_outside_turn(turn);
+        else add_inside_turn();
+    }
+
+public:
+    offset_curve_builder() :
+            distance(0), side(counterclockwise) {
+    }
+
+    /**
+     * \brief builds the offset curve of line on one side.
+     * \param offset distance of the curve to line. Has to be positive.
+     * \param left side of the curve. Curves on the right side run in opposite direction to line (like in GEOS).
+     * \param offset_xy receives the vertices of the curve. Its start and end are cut like the caps of
+     *        create_offset_curve().
+     */
+    void build(const polyline_span& line, double offset, bool left, std::vector<double>& offset_xy) {
+        assert(offset > 0);
+        offset_xy.clear();
+        if (line.size() < 2) return;
+        distance = offset;
+        side = left ? counterclockwise : clockwise;
+
+        input.clear();
+        for (size_t i = 0; i < line.size(); i++)
+            input.push_back(point { line.x(i), line.y(i) });
+        simplify(offset * simplify_factor);
+        // the right side is built on the left of the reversed line
+        if (!left) std::reverse(simplified.begin(), simplified.end());
+        if (simplified.size() < 2) throw std::runtime_error("cannot get offset curve of single-vertex line");
+
+        curve.clear();
+        s1 = simplified[0];
+        s2 = simplified[1];
+        compute_offset_segment(s1, s2, offset1);
+        add_point(offset1.p0);
+        for (size_t i = 2; i < simplified.size(); i++)
+            add_next_segment(simplified[i]);
+        add_point(offset1.p1);
+
+        // GEOS closes the curve to a ring, create_offset_curve() drops the closing point again
+        if (curve.size() > 1 && curve.front() == curve.back()) curve.pop_back();
+
+        cut_caps(offset_xy);
+    }
+
+private:
+    static point move_point(const point& moving, const point& reference, double move_distance) {
+        double ratio = move_distance / moving.distance(reference);
+        assert(ratio < 1);
+        return point { moving.x + ratio * (reference.x - moving.x), moving.y + ratio * (reference.y - moving.y) };
+    }
+
+    /**
+     * \brief cuts the curve at both ends by 10% of its length, but at most 0.00025 (like cut_caps())
+     *        and writes the remaining vertices to offset_xy. Degenerate curves (less than two vertices
+     *        or no length) are written unchanged.
+     */
+    void cut_caps(std::vector<double>& offset_xy) {
+        double length = 0;
+        for (size_t i = 1; i < curve.size(); i++)
+            length += curve[i - 1].distance(curve[i]);
+        if (curve.size() < 2 || length == 0) {
+            for (auto& pt : curve) {
+                offset_xy.push_back(pt.x);
+                offset_xy.push_back(pt.y);
+            }
+            return;
+        }
+        double cut = std::min(0.00025, length * 0.1);
+        assert(cut < length / 2);
+
+        size_t first = 0, last = curve.size() - 1;
+        double front_cut = cut;
+        while (front_cut >= curve[first].distance(curve[first + 1])) {
+            front_cut -= curve[first].distance(curve[first + 1]);
+            first++;
+        }
+        if (front_cut > 0) curve[first] = move_point(curve[first], curve[first + 1], front_cut);
+
+        double back_cut = cut;
+        while (back_cut >= curve[last].distance(curve[last - 1])) {
+            back_cut -= curve[last].distance(curve[last - 1]);
+            last--;
+        }
+        if (back_cut > 0) curve[last] = move_point(curve[last], curve[last - 1], back_cut);
+
+        offset_xy.reserve(2 * (last - first + 1));
+        for (size_t i = first; i <= last; i++) {
+            offset_xy.push_back(curve[i].x);
+            offset_xy.push_back(curve[i].y);
+        }
+    }
+};
+
+#endif /* PLUGINS_OFFSET_CURVE_HPP_ */
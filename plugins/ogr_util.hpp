@@ -9,6 +9,10 @@
 #define PLUGINS_OGR_UTIL_HPP_
 
 #include <assert.h>
+#include <strings.h>
+#include <memory>
+#include <sstream>
+#include <vector>
 #include <boost/iostreams/stream.hpp>
 
 #include <shapefil.h>
@@ -17,66 +21,238 @@
 
 #include <geos/geom/Point.h>
 #include <geos/geom/LineString.h>
+#include <geos/geom/LinearRing.h>
+#include <geos/geom/Polygon.h>
+#include <geos/geom/GeometryFactory.h>
+#include <geos/geom/CoordinateSequenceFactory.h>
 #include <geos/operation/buffer/OffsetCurveBuilder.h>
 #include <geos/operation/buffer/BufferParameters.h>
 
 #include "ogr_types.hpp"
 
 
-const geos::geom::PrecisionModel* npm;
-const geos::geom::GeometryFactory* geos_factory;
 
+// discards the log of readers. Streams aren't thread safe, so every thread has its own.
+typedef boost::iostreams::stream<boost::iostreams::null_sink> null_stream;
+thread_local null_stream cnull((boost::iostreams::null_sink()));
 
-boost::iostreams::stream<boost::iostreams::null_sink> cnull((boost::iostreams::null_sink()));
+/**
+ * \brief sequential reader of the features of a layer.
+ *        Reads the layer in file order via GetNextFeature() instead of random access via GetFeature(fid).
+ *        The current feature is owned by the cursor and freed when advancing.
+ *        If used_fields is given, all other fields are ignored by the driver and won't be parsed.
+ *        Field indices stay valid, ignored fields are unset.
+ *        If ignore_geometry is set, features are returned without geometry.
+ */
+class ogr_feature_cursor {
+    OGRLayer* layer;
+    ogr_feature_uptr feat;
+
+    void ignore_fields_except(const char* const * used_fields, size_t used_field_count, bool ignore_geometry) {
+        OGRFeatureDefn* defn = layer->GetLayerDefn();
+        std::vector<const char*> ignored_fields;
+        for (int i = 0; i < defn->GetFieldCount() && used_fields; i++) {
+            const char* field_name = defn->GetFieldDefn(i)->GetNameRef();
+            bool used = false;
+            for (size_t j = 0; j < used_field_count && !used; j++)
+                used = !strcasecmp(field_name, used_fields[j]);
+            if (!used) ignored_fields.push_back(field_name);
+        }
+        if (ignore_geometry) ignored_fields.push_back("OGR_GEOMETRY");
+        ignored_fields.push_back(nullptr);
+        if (layer->SetIgnoredFields(ignored_fields.data()) != OGRERR_NONE)
+            throw std::runtime_error("could not set ignored fields of layer");
+    }
+
+public:
+    ogr_feature_cursor(OGRLayer* layer, const char* const * used_fields = nullptr, size_t used_field_count = 0,
+            bool ignore_geometry = false) :
+            layer(layer) {
+        assert(layer);
+        if (used_fields || ignore_geometry) ignore_fields_except(used_fields, used_field_count, ignore_geometry);
+        layer->ResetReading();
+    }
+
+    ~ogr_feature_cursor() {
+        feat.reset();
+        layer->SetIgnoredFields(nullptr);
+        layer->ResetReading();
+    }
+
+    ogr_feature_cursor(const ogr_feature_cursor&) = delete;
+    ogr_feature_cursor& operator=(const ogr_feature_cursor&) = delete;
+
+    /**
+     * \brief positions the cursor, so that the next feature read is the one at index.
+     */
+    void seek(GIntBig index) {
+        if (layer->SetNextByIndex(index) != OGRERR_NONE)
+            throw std::runtime_error("could not seek to feature " + std::to_string(index));
+    }
+
+    /**
+     * \brief advances to the next feature.
+     * \return false if the end of the layer is reached.
+     */
+    bool next() {
+        feat.reset(layer->GetNextFeature());
+        return static_cast<bool>(feat);
+    }
+
+    ogr_feature_uptr& feature() {
+        assert(feat);
+        return feat;
+    }
+};
+
+/**
+ * \brief GEOS objects of one thread: precision model, geometry factory, WKB reader and
+ *        writer and their streams.
+ *
+ *        The GEOS objects must not be shared between threads, so every thread doing geometry
+ *        work uses its own context. Geometries stay bound to the factory that created them
+ *        and must not outlive their context.
+ */
+class geometry_context {
+    geos::geom::PrecisionModel precision_model;
+    geos::geom::GeometryFactory factory;
+    geos::io::WKBReader wkb_reader;
+    geos::io::WKBWriter wkb_writer;
+    std::istringstream wkb_in;
+    std::ostringstream wkb_out;
+
+public:
+    geometry_context() :
+            factory(&precision_model), wkb_reader(factory) {
+    }
+
+    geometry_context(const geometry_context&) = delete;
+    geometry_context& operator=(const geometry_context&) = delete;
+
+    const geos::geom::PrecisionModel* get_precision_model() const {
+        return &precision_model;
+    }
+
+    const geos::geom::GeometryFactory* get_factory() const {
+        return &factory;
+    }
+
+    geos::geom::Geometry* read_wkb(const std::string& wkb) {
+        wkb_in.clear();
+        wkb_in.str(wkb);
+        return wkb_reader.read(wkb_in);
+    }
+
+    std::string write_wkb(const geos::geom::Geometry *geos_geom) {
+        wkb_out.clear();
+        wkb_out.str(std::string());
+        wkb_writer.setOutputDimension(geos_geom->getCoordinateDimension());
+        wkb_writer.write(*geos_geom, wkb_out);
+        return wkb_out.str();
+    }
+};
 
 /**
- * Following functions convert OGRGeometry to geos::geom::Geometry and vice versa
+ * Following functions convert OGRGeometry to geos::geom::Geometry and vice versa.
+ * 2D line strings and polygons are converted by copying their coordinates, all other
+ * geometries are serialized to WKB. GEOS geometries are created by the factory of ctx.
  */
 
 std::string ogr2wkb(OGRGeometry *ogr_geom) {
     if (!ogr_geom || ogr_geom->IsEmpty()) throw std::runtime_error("geometry is nullptr");
-    unsigned char staticbuffer[1024 * 1024];
-    unsigned char *buffer = staticbuffer;
-    size_t wkb_size = ogr_geom->WkbSize();
-    if (wkb_size > sizeof(staticbuffer)) buffer = (unsigned char *) malloc(wkb_size);
-    ogr_geom->exportToWkb(wkbNDR, buffer);
-    std::string wkb((const char*) buffer, wkb_size);
-    if (buffer != staticbuffer) free(buffer);
+    std::string wkb(ogr_geom->WkbSize(), '\0');
+    ogr_geom->exportToWkb(wkbNDR, reinterpret_cast<unsigned char*>(&wkb[0]));
     return wkb;
 }
 
-geos::io::WKBReader* wkb_reader;
-geos::geom::Geometry* wkb2geos(std::string wkb) {
-    if (!wkb_reader) wkb_reader = new geos::io::WKBReader();
-    std::istringstream ss(wkb);
-    geos::geom::Geometry *geos_geom = wkb_reader->read(ss);
+geos::geom::CoordinateSequence* ogr2geos_coordinates(geometry_context& ctx, const OGRLineString* ogr_ls) {
+    std::vector<geos::geom::Coordinate>* coords = new std::vector<geos::geom::Coordinate>();
+    coords->reserve(ogr_ls->getNumPoints());
+    for (int i = 0; i < ogr_ls->getNumPoints(); i++)
+        coords->push_back(geos::geom::Coordinate(ogr_ls->getX(i), ogr_ls->getY(i)));
+    // the sequence takes ownership of coords
+    return ctx.get_factory()->getCoordinateSequenceFactory()->create(coords, 2);
+}
+
+geos::geom::LineString* ogr2geos(geometry_context& ctx, const OGRLineString* ogr_ls) {
+    return ctx.get_factory()->createLineString(ogr2geos_coordinates(ctx, ogr_ls));
+}
+
+geos::geom::Polygon* ogr2geos(geometry_context& ctx, const OGRPolygon* ogr_polygon) {
+    const geos::geom::GeometryFactory* factory = ctx.get_factory();
+    geos::geom::LinearRing* shell = factory->createLinearRing(ogr2geos_coordinates(ctx, ogr_polygon->getExteriorRing()));
+    std::vector<geos::geom::Geometry*>* holes = new std::vector<geos::geom::Geometry*>();
+    for (int i = 0; i < ogr_polygon->getNumInteriorRings(); i++)
+        holes->push_back(factory->createLinearRing(ogr2geos_coordinates(ctx, ogr_polygon->getInteriorRing(i))));
+    // the polygon takes ownership of shell and holes
+    return factory->createPolygon(shell, holes);
+}
+
+geos::geom::Geometry* wkb2geos(geometry_context& ctx, const std::string& wkb) {
+    geos::geom::Geometry *geos_geom = ctx.read_wkb(wkb);
     if (!geos_geom) throw std::runtime_error("creating geos::geom::Geometry from wkb failed");
     return geos_geom;
 }
 
-geos::geom::Geometry* ogr2geos(OGRGeometry* ogr_geom){
+geos::geom::Geometry* ogr2geos(geometry_context& ctx, OGRGeometry* ogr_geom){
     if (!ogr_geom || ogr_geom->IsEmpty()) throw std::runtime_error("geometry is nullptr");
-    return wkb2geos(ogr2wkb(ogr_geom));
+    // 2.5D and all other geometry types are converted via WKB
+    if (ogr_geom->getGeometryType() == wkbLineString) return ogr2geos(ctx, static_cast<OGRLineString*>(ogr_geom));
+    if (ogr_geom->getGeometryType() == wkbPolygon) return ogr2geos(ctx, static_cast<OGRPolygon*>(ogr_geom));
+    return wkb2geos(ctx, ogr2wkb(ogr_geom));
 }
 
-geos::io::WKBWriter* wkb_writer;
-std::string geos2wkb(const geos::geom::Geometry *geos_geom) {
-    if (!wkb_writer) wkb_writer = new geos::io::WKBWriter();
-    std::ostringstream ss;
-    wkb_writer->setOutputDimension(geos_geom->getCoordinateDimension());
-    wkb_writer->write(*geos_geom, ss);
-    return ss.str();
+std::string geos2wkb(geometry_context& ctx, const geos::geom::Geometry *geos_geom) {
+    return ctx.write_wkb(geos_geom);
 }
 
-OGRGeometry* wkb2ogr(std::string wkb) {
+OGRGeometry* wkb2ogr(const std::string& wkb) {
     OGRGeometry *ogr_geom;
     OGRErr res = OGRGeometryFactory::createFromWkb((unsigned char*) (wkb.c_str()), nullptr, &ogr_geom, wkb.size());
     if (res != OGRERR_NONE) throw std::runtime_error("creating OGRGeometry from wkb failed: " + std::to_string(res));
     return ogr_geom;
 }
 
-OGRGeometry* geos2ogr(const geos::geom::Geometry *geos_geom){
-    return wkb2ogr(geos2wkb(geos_geom));
+// copies the coordinates of geos_cs into ogr_ls
+void geos2ogr_coordinates(const geos::geom::CoordinateSequence* geos_cs, OGRLineString* ogr_ls) {
+    ogr_ls->setNumPoints(geos_cs->getSize(), FALSE);
+    for (size_t i = 0; i < geos_cs->getSize(); i++)
+        ogr_ls->setPoint(i, geos_cs->getAt(i).x, geos_cs->getAt(i).y);
+}
+
+OGRLineString* geos2ogr(const geos::geom::LineString* geos_ls) {
+    OGRLineString* ogr_ls = new OGRLineString();
+    geos2ogr_coordinates(geos_ls->getCoordinatesRO(), ogr_ls);
+    return ogr_ls;
+}
+
+OGRPolygon* geos2ogr(const geos::geom::Polygon* geos_polygon) {
+    OGRPolygon* ogr_polygon = new OGRPolygon();
+    OGRLinearRing* shell = new OGRLinearRing();
+    geos2ogr_coordinates(geos_polygon->getExteriorRing()->getCoordinatesRO(), shell);
+    ogr_polygon->addRingDirectly(shell);
+    for (size_t i = 0; i < geos_polygon->getNumInteriorRing(); i++) {
+        OGRLinearRing* hole = new OGRLinearRing();
+        geos2ogr_coordinates(geos_polygon->getInteriorRingN(i)->getCoordinatesRO(), hole);
+        ogr_polygon->addRingDirectly(hole);
+    }
+    return ogr_polygon;
+}
+
+OGRGeometry* geos2ogr(geometry_context& ctx, const geos::geom::Geometry *geos_geom){
+    // 3D and all other geometry types are converted via WKB
+    if (geos_geom->getCoordinateDimension() == 2) {
+        switch (geos_geom->getGeometryTypeId()) {
+            case geos::geom::GEOS_LINESTRING:
+            case geos::geom::GEOS_LINEARRING:
+                return geos2ogr(static_cast<const geos::geom::LineString*>(geos_geom));
+            case geos::geom::GEOS_POLYGON:
+                return geos2ogr(static_cast<const geos::geom::Polygon*>(geos_geom));
+            default:
+                break;
+        }
+    }
+    return wkb2ogr(geos2wkb(ctx, geos_geom));
 }
 
 geos::geom::Coordinate move_point(const geos::geom::Coordinate& moving_coord, const geos::geom::Coordinate& reference_coord,
@@ -122,7 +298,7 @@ void cut_back(double cut, geos::geom::CoordinateSequence* geos_cs) {
     if (cut > 0) geos_cs->setAt(move_point(moving_coord, reference_coord, cut), len - 1);
 }
 
-geos::geom::LineString* cut_caps(geos::geom::LineString* geos_ls) {
+geos::geom::LineString* cut_caps(geometry_context& ctx, geos::geom::LineString* geos_ls) {
     geos::geom::CoordinateSequence* geos_cs = geos_ls->getCoordinates();
 
     double cut_ratio = 0.1;
@@ -134,19 +310,21 @@ geos::geom::LineString* cut_caps(geos::geom::LineString* geos_ls) {
     cut_front(cut, geos_cs);
     cut_back(cut, geos_cs);
 
-    return geos_factory->createLineString(geos_cs);
+    return ctx.get_factory()->createLineString(geos_cs);
 }
 
-OGRLineString* create_offset_curve(OGRLineString* ogr_ls, double offset, bool left) {
-    if (!npm) npm = new geos::geom::PrecisionModel();
-    if (!geos_factory) geos_factory = new geos::geom::GeometryFactory(npm);
-
-    geos::operation::buffer::OffsetCurveBuilder* offset_curve_builder;
-    offset_curve_builder = new geos::operation::buffer::OffsetCurveBuilder(npm,
+/**
+ * \brief creates the offset curve of ogr_ls with GEOS. House numbers use offset_curve_builder,
+ *        which gives the same curves without GEOS; this is the reference for its tests.
+ */
+OGRLineString* create_offset_curve(geometry_context& ctx, OGRLineString* ogr_ls, double offset, bool left) {
+    geos::operation::buffer::OffsetCurveBuilder offset_curve_builder(ctx.get_precision_model(),
             geos::operation::buffer::BufferParameters());
 
+    std::unique_ptr<geos::geom::Geometry> geos_geom(ogr2geos(ctx, ogr_ls));
+    std::unique_ptr<geos::geom::CoordinateSequence> geos_cs(geos_geom->getCoordinates());
     std::vector<geos::geom::CoordinateSequence*> cs_vec;
-    offset_curve_builder->getSingleSidedLineCurve(ogr2geos(ogr_ls)->getCoordinates(), offset, cs_vec, left, !left);
+    offset_curve_builder.getSingleSidedLineCurve(geos_cs.get(), offset, cs_vec, left, !left);
     assert(cs_vec.size() == 1);
 
     auto cs = cs_vec.at(0);
@@ -154,12 +332,9 @@ OGRLineString* create_offset_curve(OGRLineString* ogr_ls, double offset, bool le
     // getSingleSidedLineCurve() always produces a ring (bug?). therefore: first_coord == last_coord => drop last_coord
     if (cs->getAt(0) == cs->getAt(cs->getSize() - 1)) cs->deleteAt(cs->size() - 1);
 
-    geos::geom::LineString* offset_geos_ls = geos_factory->createLineString(cs);
-    offset_geos_ls = cut_caps(offset_geos_ls);
-    OGRGeometry* offset_ogr_geom = geos2ogr(offset_geos_ls);
-    delete offset_geos_ls;
-
-    return static_cast<OGRLineString*>(offset_ogr_geom);
+    std::unique_ptr<geos::geom::LineString> offset_geos_ls(ctx.get_factory()->createLineString(cs));
+    std::unique_ptr<geos::geom::LineString> cut_geos_ls(cut_caps(ctx, offset_geos_ls.get()));
+    return geos2ogr(cut_geos_ls.get());
 }
 
 
@@ -8,7 +8,18 @@
 #ifndef PLUGINS_READERS_HPP_
 #define PLUGINS_READERS_HPP_
 
+#include <assert.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+
+#include <shapefil.h>
 #include <gdal/ogrsf_frmts.h>
+#include <osmium/osm/location.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include "comm2osm_exceptions.hpp"
@@ -41,4 +52,336 @@ DBFHandle read_dbf_file(boost::filesystem::path dbf_file, std::ostream& out = st
     return handle;
 }
 
+/**
+ * \brief Read-only memory mapping of a whole file.
+ *
+ *        The mapping is released when the object is destroyed.
+ */
+class mmap_file {
+    const char* data_ptr;
+    size_t data_size;
+
+public:
+    mmap_file(const boost::filesystem::path& file) :
+            data_ptr(nullptr), data_size(0) {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd == -1) throw(osmium::io_error("could not open " + file.string()));
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            close(fd);
+            throw(osmium::io_error("could not stat " + file.string()));
+        }
+        data_size = st.st_size;
+        if (data_size > 0) {
+            void* ptr = mmap(nullptr, data_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED) {
+                close(fd);
+                throw(osmium::io_error("could not mmap " + file.string()));
+            }
+            // records are read front to back
+            madvise(ptr, data_size, MADV_SEQUENTIAL);
+            data_ptr = static_cast<const char*>(ptr);
+        }
+        // the mapping stays valid after closing the descriptor
+        close(fd);
+    }
+
+    ~mmap_file() {
+        if (data_ptr) munmap(const_cast<char*>(data_ptr), data_size);
+    }
+
+    mmap_file(const mmap_file&) = delete;
+    mmap_file& operator=(const mmap_file&) = delete;
+
+    const char* data() const {
+        return data_ptr;
+    }
+
+    size_t size() const {
+        return data_size;
+    }
+};
+
+/**
+ * \brief View on a field value inside the mapped record area of a DBF file.
+ *        Leading and trailing blanks are trimmed (like shapelib does).
+ */
+struct dbf_field_view {
+    const char* data;
+    size_t size;
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    std::string str() const {
+        return std::string(data, size);
+    }
+
+    bool operator==(const char* rhs) const {
+        return strlen(rhs) == size && !strncmp(data, rhs, size);
+    }
+
+    bool operator!=(const char* rhs) const {
+        return !(*this == rhs);
+    }
+};
+
+/**
+ * \brief Reads DBF files through a memory mapping without copying field values.
+ *
+ *        DBF files consist of a header with field descriptors followed by
+ *        fixed-width records, so every field of every record can be addressed
+ *        directly in the mapped file. Numeric fields are decoded in place.
+ */
+class mmap_dbf_reader {
+    struct dbf_field_descriptor {
+        char name[12];
+        char type;
+        size_t offset;
+        size_t length;
+    };
+
+    boost::filesystem::path dbf_file;
+    mmap_file file;
+    int num_records;
+    size_t header_length;
+    size_t record_length;
+    std::vector<dbf_field_descriptor> fields;
+
+    static uint32_t read_le32(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t) u[3] << 24);
+    }
+
+    static uint16_t read_le16(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return u[0] | (u[1] << 8);
+    }
+
+    void parse_header() {
+        const char* data = file.data();
+        if (file.size() < 32) throw(dbf_error(dbf_file.string()));
+
+        num_records = read_le32(data + 4);
+        header_length = read_le16(data + 8);
+        record_length = read_le16(data + 10);
+        if (header_length > file.size() || record_length == 0) throw(dbf_error(dbf_file.string()));
+
+        // field descriptors are 32 bytes each and terminated by 0x0D
+        size_t offset = 1; // first byte of each record is the deletion flag
+        for (size_t pos = 32; pos + 32 <= header_length && data[pos] != 0x0D; pos += 32) {
+            dbf_field_descriptor field;
+            memcpy(field.name, data + pos, 11);
+            field.name[11] = '\0';
+            field.type = data[pos + 11];
+            field.offset = offset;
+            field.length = static_cast<unsigned char>(data[pos + 16]);
+            offset += field.length;
+            fields.push_back(field);
+        }
+        if (offset > record_length) throw(dbf_error(dbf_file.string() + " has inconsistent field lengths"));
+        if (header_length + (size_t) num_records * record_length > file.size())
+            throw(dbf_error(dbf_file.string() + " is truncated"));
+    }
+
+    const char* field_ptr(int row, int field) const {
+        assert(row >= 0 && row < num_records);
+        assert(field >= 0 && field < (int) fields.size());
+        return file.data() + header_length + (size_t) row * record_length + fields[field].offset;
+    }
+
+public:
+    mmap_dbf_reader(const boost::filesystem::path& dbf_file, std::ostream& out = std::cerr) :
+            dbf_file(dbf_file), file(dbf_file), num_records(0), header_length(0), record_length(0) {
+        out << "reading " << dbf_file << std::endl;
+        parse_header();
+    }
+
+    int record_count() const {
+        return num_records;
+    }
+
+    /**
+     * \brief returns index of field (case insensitive like DBFGetFieldIndex).
+     * \return index of field or -1 if field doesn't exist.
+     */
+    int field_index(const char* field_name) const {
+        for (size_t i = 0; i < fields.size(); i++)
+            if (!strcasecmp(fields[i].name, field_name)) return i;
+        return -1;
+    }
+
+    /**
+     * \brief returns trimmed field value pointing into the mapped file.
+     */
+    dbf_field_view get_field(int row, int field) const {
+        const char* begin = field_ptr(row, field);
+        const char* end = begin + fields[field].length;
+        while (begin < end && (*begin == ' ' || *begin == '\0'))
+            begin++;
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\0'))
+            end--;
+        return dbf_field_view { begin, static_cast<size_t>(end - begin) };
+    }
+
+    /**
+     * \brief decodes numeric field in place.
+     *        Behaves like DBFReadIntegerAttribute: decimals are truncated, empty fields are 0.
+     */
+    int64_t get_int(int row, int field) const {
+        dbf_field_view value = get_field(row, field);
+        const char* p = value.data;
+        const char* end = p + value.size;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+        int64_t result = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            result = result * 10 + (*p - '0');
+        return negative ? -result : result;
+    }
+
+    std::string get_string(int row, int field) const {
+        return get_field(row, field).str();
+    }
+};
+
+/**
+ * \brief View on the vertices of a polyline stored as flat array [x0, y0, x1, y1, ...].
+ *        Doesn't own the coordinates.
+ */
+class polyline_span {
+    const double* xy;
+    size_t num_points;
+
+public:
+    polyline_span(const double* xy = nullptr, size_t num_points = 0) :
+            xy(xy), num_points(num_points) {
+    }
+
+    size_t size() const {
+        return num_points;
+    }
+
+    const double* data() const {
+        return xy;
+    }
+
+    double x(size_t i) const {
+        assert(i < num_points);
+        return xy[2 * i];
+    }
+
+    double y(size_t i) const {
+        assert(i < num_points);
+        return xy[2 * i + 1];
+    }
+
+    osmium::Location location(size_t i) const {
+        return osmium::Location(x(i), y(i));
+    }
+
+    /**
+     * \brief returns the vertices [start_index, end_index] inclusive.
+     */
+    polyline_span sub(size_t start_index, size_t end_index) const {
+        assert(start_index < end_index && end_index < num_points);
+        return polyline_span(xy + 2 * start_index, end_index - start_index + 1);
+    }
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "shp_polyline_reader requires a little endian host"
+#endif
+
+/**
+ * \brief Decodes single part polylines of a .shp file by feature id.
+ *
+ *        Both the .shp and its .shx index are memory mapped. The record of a feature
+ *        is looked up in the .shx and its vertices are copied into a scratch buffer,
+ *        so no OGRGeometry is created. The returned span is valid until the next read().
+ */
+class shp_polyline_reader {
+    static const int SHP_FILE_CODE = 9994;
+    static const size_t SHP_HEADER_LENGTH = 100;
+    static const size_t SHX_RECORD_LENGTH = 8;
+
+    boost::filesystem::path shp_file;
+    mmap_file shp;
+    mmap_file shx;
+    size_t num_records;
+    std::vector<double> scratch;
+
+    static uint32_t read_be32(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return ((uint32_t) u[0] << 24) | (u[1] << 16) | (u[2] << 8) | u[3];
+    }
+
+    static int32_t read_le32(const char* p) {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static boost::filesystem::path shx_path(boost::filesystem::path shp_file) {
+        return shp_file.replace_extension(".shx");
+    }
+
+    void check_header(const mmap_file& file, const std::string& name) const {
+        if (file.size() < SHP_HEADER_LENGTH || read_be32(file.data()) != SHP_FILE_CODE)
+            throw(shp_error(name + " has no valid header"));
+        int shape_type = read_le32(file.data() + 32);
+        if (shape_type != SHPT_ARC && shape_type != SHPT_ARCZ && shape_type != SHPT_ARCM)
+            throw(shp_error(name + " doesn't contain polylines"));
+    }
+
+public:
+    shp_polyline_reader(const boost::filesystem::path& shp_file) :
+            shp_file(shp_file), shp(shp_file), shx(shx_path(shp_file)), num_records(0) {
+        check_header(shp, shp_file.string());
+        check_header(shx, shx_path(shp_file).string());
+        num_records = (shx.size() - SHP_HEADER_LENGTH) / SHX_RECORD_LENGTH;
+    }
+
+    size_t record_count() const {
+        return num_records;
+    }
+
+    /**
+     * \brief decodes the vertices of feature fid.
+     *        throws shp_error for null shapes, multipart polylines and truncated records.
+     */
+    polyline_span read(size_t fid) {
+        if (fid >= num_records) throw(shp_error(shp_file.string() + ": invalid feature id " + std::to_string(fid)));
+        const char* shx_record = shx.data() + SHP_HEADER_LENGTH + fid * SHX_RECORD_LENGTH;
+        // .shx stores offset and content length in 16 bit words
+        size_t offset = (size_t) read_be32(shx_record) * 2;
+        size_t content_length = (size_t) read_be32(shx_record + 4) * 2;
+        // record header (8 bytes) + shape type (4) + bounding box (32) + NumParts (4) + NumPoints (4) + Parts[1] (4)
+        if (offset + 8 + content_length > shp.size() || content_length < 4)
+            throw(shp_error(shp_file.string() + " is truncated"));
+
+        const char* content = shp.data() + offset + 8;
+        int shape_type = read_le32(content);
+        if (shape_type == SHPT_NULL)
+            throw(shp_error(shp_file.string() + ": feature " + std::to_string(fid) + " has no geometry"));
+        if (shape_type != SHPT_ARC && shape_type != SHPT_ARCZ && shape_type != SHPT_ARCM)
+            throw(shp_error(shp_file.string() + ": feature " + std::to_string(fid) + " is not a polyline"));
+        if (content_length < 48) throw(shp_error(shp_file.string() + " is truncated"));
+
+        int32_t num_parts = read_le32(content + 36);
+        int32_t num_points = read_le32(content + 40);
+        if (num_parts != 1)
+            throw(shp_error(shp_file.string() + ": feature " + std::to_string(fid) + " is not a single linestring"));
+        const char* points = content + 44 + 4 * num_parts;
+        if (num_points < 2 || points + 16 * (size_t) num_points > content + content_length)
+            throw(shp_error(shp_file.string() + ": feature " + std::to_string(fid) + " has invalid vertices"));
+
+        // records are only aligned to 16 bit words => copy instead of pointing into the mapping
+        scratch.resize(2 * num_points);
+        memcpy(scratch.data(), points, 16 * (size_t) num_points);
+        return polyline_span(scratch.data(), num_points);
+    }
+};
+
 #endif /* PLUGINS_READERS_HPP_ */
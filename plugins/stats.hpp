@@ -0,0 +1,182 @@
+/*
+ * stats.hpp
+ *
+ * Timing, throughput and memory statistics of conversion phases.
+ */
+
+#ifndef PLUGINS_STATS_HPP_
+#define PLUGINS_STATS_HPP_
+
+#include <assert.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Format of the statistics report (--stats[=json]).
+ */
+enum class stats_format {
+    none, text, json
+};
+
+/**
+ * \brief Records wall time, cpu time, processed rows, created objects and peak memory
+ *        of consecutive phases of a conversion.
+ *
+ *        Rows are features or DBF records read in a phase, objects are the OSM objects
+ *        created in it. Cpu time is summed over all threads and terminated child processes
+ *        which have been waited for, so it exceeds the wall time in phases with several workers.
+ *        Rows and objects of child processes have to be added with add_rows() and add_objects().
+ */
+class conversion_stats {
+public:
+    struct phase {
+        std::string name;
+        double wall_seconds;
+        double cpu_seconds;
+        uint64_t rows;
+        uint64_t objects;
+        // peak resident set size of the process (or its largest child) at the end of the phase in kilobytes
+        long max_rss_kb;
+    };
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    std::vector<phase> phases;
+    bool running;
+    clock_type::time_point wall_start;
+    double cpu_start;
+    uint64_t objects_start;
+
+    static double cpu_seconds(const rusage& usage) {
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    // cpu seconds of this process and its waited for children
+    static double cpu_seconds(const rusage& self, const rusage& children) {
+        return cpu_seconds(self) + cpu_seconds(children);
+    }
+
+    static double per_second(uint64_t count, double seconds) {
+        return seconds > 0 ? count / seconds : 0;
+    }
+
+    // phase names are literals of the converters, only '"' and '\' would need escaping
+    static std::string json_string(const std::string& s) {
+        std::string escaped = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+public:
+    conversion_stats() :
+            running(false), cpu_start(0), objects_start(0) {
+    }
+
+    /**
+     * \brief starts a phase.
+     * \param objects current value of the object counter of the converter.
+     */
+    void begin(const std::string& name, uint64_t objects) {
+        assert(!running);
+        rusage usage, children_usage;
+        getrusage(RUSAGE_SELF, &usage);
+        getrusage(RUSAGE_CHILDREN, &children_usage);
+        phases.push_back(phase { name, 0, 0, 0, 0, 0 });
+        running = true;
+        wall_start = clock_type::now();
+        cpu_start = cpu_seconds(usage, children_usage);
+        objects_start = objects;
+    }
+
+    /**
+     * \brief adds rows to the running phase.
+     */
+    void add_rows(uint64_t rows) {
+        if (running) phases.back().rows += rows;
+    }
+
+    /**
+     * \brief adds objects created outside of the object counter (e.g. by child processes) to the running phase.
+     */
+    void add_objects(uint64_t objects) {
+        if (running) phases.back().objects += objects;
+    }
+
+    /**
+     * \brief ends the running phase.
+     * \param objects current value of the object counter of the converter.
+     */
+    void end(uint64_t objects) {
+        assert(running);
+        rusage usage, children_usage;
+        getrusage(RUSAGE_SELF, &usage);
+        getrusage(RUSAGE_CHILDREN, &children_usage);
+        phase& p = phases.back();
+        p.wall_seconds = std::chrono::duration<double>(clock_type::now() - wall_start).count();
+        p.cpu_seconds = cpu_seconds(usage, children_usage) - cpu_start;
+        p.objects += objects - objects_start;
+        // the largest child if it needed more memory than this process
+        p.max_rss_kb = std::max(usage.ru_maxrss, children_usage.ru_maxrss);
+        running = false;
+    }
+
+    const std::vector<phase>& get_phases() const {
+        return phases;
+    }
+
+    void write_text(std::ostream& out) const {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::left << std::setw(26) << "phase" << std::right << std::setw(10) << "wall [s]" << std::setw(10)
+                << "cpu [s]" << std::setw(12) << "rows" << std::setw(12) << "rows/s" << std::setw(12) << "objects"
+                << std::setw(12) << "objects/s" << std::setw(14) << "max rss [MB]" << std::endl;
+        out << std::fixed;
+        for (auto& p : phases) {
+            out << std::left << std::setw(26) << p.name << std::right << std::setprecision(2) << std::setw(10)
+                    << p.wall_seconds << std::setw(10) << p.cpu_seconds << std::setw(12) << p.rows
+                    << std::setprecision(0) << std::setw(12) << per_second(p.rows, p.wall_seconds) << std::setw(12)
+                    << p.objects << std::setw(12) << per_second(p.objects, p.wall_seconds) << std::setw(14)
+                    << p.max_rss_kb / 1024 << std::endl;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    void write_json(std::ostream& out) const {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out.unsetf(std::ios_base::floatfield);
+        out.precision(9);
+        out << "{\"phases\":[";
+        for (size_t i = 0; i < phases.size(); i++) {
+            const phase& p = phases.at(i);
+            if (i) out << ",";
+            out << "{\"name\":" << json_string(p.name) << ",\"wall_seconds\":" << p.wall_seconds
+                    << ",\"cpu_seconds\":" << p.cpu_seconds << ",\"rows\":" << p.rows << ",\"rows_per_second\":"
+                    << per_second(p.rows, p.wall_seconds) << ",\"objects\":" << p.objects
+                    << ",\"objects_per_second\":" << per_second(p.objects, p.wall_seconds) << ",\"max_rss_kb\":"
+                    << p.max_rss_kb << "}";
+        }
+        out << "]}" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    void write(std::ostream& out, stats_format format) const {
+        if (format == stats_format::json) write_json(out);
+        else if (format == stats_format::text) write_text(out);
+    }
+};
+
+#endif /* PLUGINS_STATS_HPP_ */
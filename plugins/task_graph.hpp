@@ -0,0 +1,180 @@
+/*
+ * task_graph.hpp
+ *
+ * Runs independent loading tasks concurrently, respecting their dependencies.
+ */
+
+#ifndef PLUGINS_TASK_GRAPH_HPP_
+#define PLUGINS_TASK_GRAPH_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Tasks which are run by a few threads as soon as the tasks they depend on are done.
+ *
+ *        A task may only depend on tasks added before, so the graph has no cycles. Every task
+ *        should write its own data structures; results of several tasks are combined by a task
+ *        depending on all of them, which keeps the results independent of the scheduling.
+ *        Ready tasks are started in the order they were added. The wall time of every task is
+ *        recorded for write_timing().
+ */
+class task_graph {
+public:
+    typedef size_t task_id;
+
+    struct task {
+        std::string name;
+        std::function<void()> function;
+        std::vector<task_id> dependencies;
+        // seconds since run() when the task started and finished
+        double start_seconds;
+        double end_seconds;
+    };
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    std::vector<task> tasks;
+
+    // scheduling state of run()
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<size_t> pending_dependencies;
+    std::vector<std::vector<task_id>> dependents;
+    std::set<task_id> ready;
+    size_t running;
+    size_t done;
+    // exception of the first failed task, no further tasks are started then
+    std::exception_ptr exception;
+    task_id failed_task;
+    clock_type::time_point start;
+
+    double seconds_since_start() const {
+        return std::chrono::duration<double>(clock_type::now() - start).count();
+    }
+
+    bool finished() const {
+        return done == tasks.size() || (exception && running == 0);
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] {return finished() || (!exception && !ready.empty());});
+            if (finished()) return;
+
+            task_id id = *ready.begin();
+            ready.erase(ready.begin());
+            running++;
+            lock.unlock();
+
+            std::exception_ptr task_exception;
+            double start_seconds = seconds_since_start();
+            try {
+                tasks.at(id).function();
+            } catch (...) {
+                task_exception = std::current_exception();
+            }
+            double end_seconds = seconds_since_start();
+
+            lock.lock();
+            running--;
+            tasks.at(id).start_seconds = start_seconds;
+            tasks.at(id).end_seconds = end_seconds;
+            if (task_exception) {
+                if (!exception || id < failed_task) {
+                    exception = task_exception;
+                    failed_task = id;
+                }
+            } else {
+                done++;
+                for (task_id dependent : dependents.at(id))
+                    if (--pending_dependencies.at(dependent) == 0) ready.insert(dependent);
+            }
+            changed.notify_all();
+        }
+    }
+
+public:
+    task_graph() :
+            running(0), done(0), failed_task(0) {
+    }
+
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    /**
+     * \brief adds a task which is run after all tasks in dependencies.
+     * \return id of the task to be used in dependencies of later tasks.
+     */
+    task_id add(const std::string& name, std::function<void()> function, const std::vector<task_id>& dependencies =
+            std::vector<task_id>()) {
+        for (task_id dependency : dependencies)
+            assert(dependency < tasks.size());
+        tasks.push_back(task { name, function, dependencies, 0, 0 });
+        return tasks.size() - 1;
+    }
+
+    /**
+     * \brief runs all tasks with up to threads threads including the calling thread.
+     *        If tasks fail, running tasks are finished and the exception of the failed task
+     *        added first is rethrown.
+     */
+    void run(unsigned int threads) {
+        pending_dependencies.assign(tasks.size(), 0);
+        dependents.assign(tasks.size(), std::vector<task_id>());
+        ready.clear();
+        for (task_id id = 0; id < tasks.size(); id++) {
+            pending_dependencies.at(id) = tasks.at(id).dependencies.size();
+            for (task_id dependency : tasks.at(id).dependencies)
+                dependents.at(dependency).push_back(id);
+            if (tasks.at(id).dependencies.empty()) ready.insert(id);
+        }
+        running = 0;
+        done = 0;
+        exception = nullptr;
+        start = clock_type::now();
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < std::min<size_t>(threads, tasks.size()); i++)
+            workers.push_back(std::thread(&task_graph::work, this));
+        work();
+        for (auto& worker : workers)
+            worker.join();
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    const std::vector<task>& get_tasks() const {
+        return tasks;
+    }
+
+    /**
+     * \brief writes start and duration of the tasks of the last run().
+     */
+    void write_timing(std::ostream& out) const {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(2);
+        for (auto& t : tasks) {
+            out << "  " << std::left << std::setw(24) << t.name << std::right << " start " << std::setw(8)
+                    << t.start_seconds << " s, took " << std::setw(8) << t.end_seconds - t.start_seconds << " s"
+                    << std::endl;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+#endif /* PLUGINS_TASK_GRAPH_HPP_ */
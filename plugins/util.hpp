@@ -107,8 +107,67 @@ uint64_t dbf_get_uint_by_field(DBFHandle handle, int row, const char *field_name
     return DBFReadIntegerAttribute(handle, row, dbf_get_field_index(handle, row, field_name));
 }
 
+/**
+ * \brief resolves field index once per DBF file, so that rows can be read by index.
+ *        throws exception if the field is missing.
+ */
+int dbf_get_field_index(const mmap_dbf_reader& dbf, const char *field_name) {
+    assert(field_name);
+    int index = dbf.field_index(field_name);
+    if (index == -1) throw(std::runtime_error("DBFfile doesnt contain " + std::string(field_name)));
+    return index;
+}
+
+int dbf_get_field_index(const mmap_dbf_reader& dbf, int row, const char *field_name) {
+    assert(row < dbf.record_count());
+    return dbf_get_field_index(dbf, field_name);
+}
+
+std::string dbf_get_string_by_field(const mmap_dbf_reader& dbf, int row, const char *field_name) {
+    return dbf.get_string(row, dbf_get_field_index(dbf, row, field_name));
+}
+
+uint64_t dbf_get_uint_by_field(const mmap_dbf_reader& dbf, int row, const char *field_name) {
+    return dbf.get_int(row, dbf_get_field_index(dbf, row, field_name));
+}
+
 /* getting fields from OGRFeatures -- begin */
 
+/**
+ * \brief field indices of a fixed list of columns.
+ *        Resolved once per layer, so that fields of every feature can be read by index.
+ *        Throws format_error if the layer misses one of the columns.
+ */
+class ogr_field_binding {
+    OGRFeatureDefn* defn;
+    std::vector<int> indices;
+
+public:
+    ogr_field_binding() :
+            defn(nullptr) {
+    }
+
+    ogr_field_binding(OGRFeatureDefn* defn, const char* const * field_names, size_t field_count) :
+            defn(defn) {
+        assert(defn);
+        indices.reserve(field_count);
+        for (size_t i = 0; i < field_count; i++) {
+            int field_index = defn->GetFieldIndex(field_names[i]);
+            if (field_index == -1) throw format_error("layer misses column '" + std::string(field_names[i]) + "'");
+            indices.push_back(field_index);
+        }
+    }
+
+    bool is_bound_to(OGRFeatureDefn* rhs) const {
+        return defn && defn == rhs;
+    }
+
+    int operator[](size_t field) const {
+        assert(field < indices.size());
+        return indices[field];
+    }
+};
+
 /**
  * \brief returns field from OGRFeature
  *        aborts if feature is nullpointer or field key is invalid
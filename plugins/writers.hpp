@@ -0,0 +1,164 @@
+/*
+ * writers.hpp
+ *
+ * Writing osmium buffers while converting.
+ */
+
+#ifndef PLUGINS_WRITERS_HPP_
+#define PLUGINS_WRITERS_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <osmium/io/error.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/memory/buffer.hpp>
+
+/**
+ * \brief Spools the committed contents of buffers to an anonymous temporary file.
+ *
+ *        Items in osmium buffers are position independent, so the spooled bytes
+ *        can be restored into new buffers later on.
+ */
+class buffer_spool {
+    FILE* file;
+    std::vector<size_t> chunk_sizes;
+
+public:
+    buffer_spool() :
+            file(tmpfile()) {
+        if (!file) throw(osmium::io_error("could not create temporary file"));
+    }
+
+    ~buffer_spool() {
+        fclose(file);
+    }
+
+    buffer_spool(const buffer_spool&) = delete;
+    buffer_spool& operator=(const buffer_spool&) = delete;
+
+    /**
+     * \brief appends the committed contents of buffer to the spool and clears buffer.
+     */
+    void write(osmium::memory::Buffer& buffer) {
+        assert(buffer.committed() == buffer.written());
+        size_t size = buffer.committed();
+        if (size == 0) return;
+        if (fwrite(buffer.data(), 1, size, file) != size) throw(osmium::io_error("could not write temporary file"));
+        chunk_sizes.push_back(size);
+        buffer.clear();
+    }
+
+    /**
+     * \brief passes the spooled chunks as buffers to func in the order they were written.
+     *        The spool is empty afterwards.
+     */
+    template <class TFunction>
+    void replay(TFunction func) {
+        rewind(file);
+        for (size_t size : chunk_sizes) {
+            osmium::memory::Buffer chunk(size, osmium::memory::Buffer::auto_grow::no);
+            if (fread(chunk.reserve_space(size), 1, size, file) != size)
+                throw(osmium::io_error("could not read temporary file"));
+            chunk.commit();
+            func(std::move(chunk));
+        }
+        chunk_sizes.clear();
+        rewind(file);
+    }
+};
+
+/**
+ * \brief writes the committed contents of buffer to file_name and clears buffer.
+ *        read_buffer_file() restores them, e.g. in another process.
+ */
+void write_buffer_file(osmium::memory::Buffer& buffer, const std::string& file_name) {
+    assert(buffer.committed() == buffer.written());
+    FILE* file = fopen(file_name.c_str(), "wb");
+    if (!file) throw(osmium::io_error("could not create " + file_name));
+    size_t size = buffer.committed();
+    bool written = fwrite(buffer.data(), 1, size, file) == size;
+    if (fclose(file) != 0 || !written) throw(osmium::io_error("could not write " + file_name));
+    buffer.clear();
+}
+
+/**
+ * \brief reads the objects written by write_buffer_file() into one buffer.
+ */
+osmium::memory::Buffer read_buffer_file(const std::string& file_name) {
+    FILE* file = fopen(file_name.c_str(), "rb");
+    if (!file) throw(osmium::io_error("could not open " + file_name));
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    // a buffer needs some capacity even if there are no objects
+    osmium::memory::Buffer buffer(std::max(size, 64L), osmium::memory::Buffer::auto_grow::no);
+    bool read = size >= 0 && fread(buffer.reserve_space(size), 1, size, file) == size_t(size);
+    fclose(file);
+    if (!read) throw(osmium::io_error("could not read " + file_name));
+    buffer.commit();
+    return buffer;
+}
+
+/**
+ * \brief Writes OSM objects to a file while they are still being created.
+ *
+ *        OSM files are sorted by type (nodes, ways, relations), but the converters create
+ *        nodes until the end. Therefore nodes are passed to the osmium::io::Writer right away
+ *        while ways and relations are spooled to temporary files and appended by close().
+ */
+class streaming_osm_writer {
+    osmium::io::Writer writer;
+    buffer_spool way_spool;
+    buffer_spool relation_spool;
+
+    void write(osmium::memory::Buffer&& buffer) {
+        writer(std::move(buffer));
+    }
+
+public:
+    streaming_osm_writer(const osmium::io::File& file, const osmium::io::Header& header) :
+            writer(file, header, osmium::io::overwrite::allow) {
+    }
+
+    /**
+     * \brief passes the committed nodes of buffer to the writer and clears buffer.
+     *        The buffer keeps its capacity.
+     */
+    void write_nodes(osmium::memory::Buffer& buffer) {
+        assert(buffer.committed() == buffer.written());
+        if (buffer.committed() == 0) return;
+        osmium::memory::Buffer chunk(buffer.committed());
+        chunk.add_buffer(buffer);
+        chunk.commit();
+        buffer.clear();
+        write(std::move(chunk));
+    }
+
+    void write_ways(osmium::memory::Buffer& buffer) {
+        way_spool.write(buffer);
+    }
+
+    void write_relations(osmium::memory::Buffer& buffer) {
+        relation_spool.write(buffer);
+    }
+
+    /**
+     * \brief writes the remaining objects of the buffers, appends spooled ways and relations
+     *        and closes the file.
+     */
+    void close(osmium::memory::Buffer& node_buffer, osmium::memory::Buffer& way_buffer,
+            osmium::memory::Buffer& rel_buffer) {
+        write_nodes(node_buffer);
+        way_spool.write(way_buffer);
+        relation_spool.write(rel_buffer);
+        way_spool.replay([this](osmium::memory::Buffer&& chunk) {write(std::move(chunk));});
+        relation_spool.replay([this](osmium::memory::Buffer&& chunk) {write(std::move(chunk));});
+        writer.close();
+    }
+};
+
+#endif /* PLUGINS_WRITERS_HPP_ */
@@ -0,0 +1,379 @@
+/*
+ * bench_navteq2osm.cpp
+ *
+ * Micro benchmarks of the kernels of the navteq converter.
+ *
+ * usage: navteq_bench [FILTER]
+ * runs all benchmarks whose name contains FILTER and reports time and allocations per
+ * operation. Allocations are counted by the global operator new, memory allocated with
+ * malloc (e.g. by GDAL) isn't counted.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <random>
+#include <sstream>
+
+#include "../../plugins/navteq/navteq.hpp"
+#include "../../plugins/navteq/navteq_plugin.hpp"
+
+static uint64_t g_allocations = 0;
+
+void* operator new(std::size_t size) {
+    g_allocations++;
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+// minimal run time of a benchmark in seconds
+static const double min_seconds = 0.3;
+
+static std::string g_filter;
+
+/**
+ * \brief runs func repeatedly for at least min_seconds and prints time and allocations per call.
+ *        The batch size doubles, so clock reads don't distort fast kernels.
+ */
+template <class TFunction>
+void bench(const std::string& name, TFunction func) {
+    if (name.find(g_filter) == std::string::npos) return;
+
+    // warm up caches and lazily initialized state
+    func();
+
+    typedef std::chrono::steady_clock clock_type;
+    uint64_t ops = 0;
+    uint64_t allocations_start = g_allocations;
+    auto start = clock_type::now();
+    double seconds = 0;
+    for (uint64_t batch = 1; seconds < min_seconds; batch *= 2) {
+        for (uint64_t i = 0; i < batch; i++)
+            func();
+        ops += batch;
+        seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    }
+    uint64_t allocations = g_allocations - allocations_start;
+
+    std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << seconds * 1e9 / ops << std::setprecision(2) << std::setw(12)
+            << double(allocations) / ops << std::setw(12) << ops << std::endl;
+}
+
+/**
+ * \brief clears the output buffers when they are half full, so that repeated calls of
+ *        the kernels don't let them grow without bounds.
+ */
+void recycle_buffers() {
+    if (g_node_buffer.committed() < buffer_size / 2 && g_way_buffer.committed() < buffer_size / 2) return;
+    g_node_buffer.clear();
+    g_way_buffer.clear();
+    g_rel_buffer.clear();
+    g_link_ways.clear();
+}
+
+/**
+ * \brief resets all state between benchmarks.
+ */
+void reset_state() {
+    clear_all();
+    g_way_end_points_map.clear();
+    g_z_lvl_nodes_map.clear();
+}
+
+/**
+ * \brief Street feature with the attributes of tests/navteq/create_street_geojson.py.
+ *        g_streets_binding is bound to its definition.
+ */
+class street_feature {
+    OGRFeatureDefn* defn;
+
+public:
+    ogr_feature_uptr feat;
+
+    street_feature() :
+            defn(new OGRFeatureDefn("Streets")) {
+        defn->Reference();
+        std::map<std::string, const char*> values = { { LINK_ID, "2147483647" }, { ST_NAME, "E20 " }, { ADDR_TYPE, "" },
+                { L_REFADDR, " " }, { L_NREFADDR, " " }, { L_ADDRSCH, "" }, { R_REFADDR, " " }, { R_NREFADDR, " " },
+                { R_ADDRSCH, "" }, { FUNC_CLASS, "1" }, { SPEED_CAT, "2" }, { FR_SPEED_LIMIT, "110" },
+                { TO_SPEED_LIMIT, "0" }, { DIR_TRAVEL, "F" }, { AR_AUTO, "Y" }, { AR_BUS, "Y" }, { AR_TAXIS, "Y" },
+                { AR_PEDESTRIANS, "N" }, { AR_TRUCKS, "Y" }, { AR_EMERVEH, "Y" }, { AR_MOTORCYCLES, "Y" },
+                { AR_THROUGH_TRAFFIC, "Y" }, { PAVED, "Y" }, { PRIVATE, "N" }, { BRIDGE, "Y" }, { TUNNEL, "N" },
+                { TOLLWAY, "N" }, { ROUNDABOUT, "N" }, { FERRY, "H" }, { URBAN, "N" }, { ROUTE, "1" },
+                { FOURWHLDR, "N" }, { PHYS_LANES, "0" }, { PUB_ACCESS, "Y" }, { L_AREA_ID, "20367962" },
+                { R_AREA_ID, "20367962" }, { L_POSTCODE, "5500 " }, { R_POSTCODE, "5500 " } };
+        for (int i = 0; i < STREETS_FIELD_COUNT; i++) {
+            OGRFieldDefn field_defn(STREETS_FIELDS[i], OFTString);
+            defn->AddFieldDefn(&field_defn);
+        }
+        feat.reset(new OGRFeature(defn));
+        for (int i = 0; i < STREETS_FIELD_COUNT; i++)
+            feat->SetField(i, values.at(STREETS_FIELDS[i]));
+        g_streets_binding = ogr_field_binding(defn, STREETS_FIELDS, STREETS_FIELD_COUNT);
+    }
+
+    ~street_feature() {
+        feat.reset();
+        defn->Release();
+    }
+};
+
+/**
+ * \brief returns the vertices of a diagonal line with num_points points like create_street_geojson.py.
+ */
+std::vector<double> diagonal_line(size_t num_points) {
+    std::vector<double> xy;
+    for (size_t i = 0; i < num_points; i++) {
+        xy.push_back(10.0 + 0.001 * i);
+        xy.push_back(10.0 + 0.001 * i);
+    }
+    return xy;
+}
+
+void bench_parse_street_tags(street_feature& street) {
+    // a height restriction exercises the lookups of conditional modifications
+    link_id_type link_id = get_uint_from_feature(street.feat, SF_LINK_ID);
+    g_cdms_map.add(link_id, 1, CT_TRANSPORT_ACCESS_RESTRICTION);
+    g_cdms_map.sort();
+    g_cnd_mod_rows.push_back(std::make_pair(1, mod_group_type(MT_HEIGHT_RESTRICTION, 400)));
+    init_link_restrictions();
+    g_area_to_govt_code_map[20367962] = 208;
+    g_cntry_ref_map[208] = cntry_ref_type('M', "KPH", "DK");
+
+    osmium::memory::Buffer buffer(1024 * 1024);
+    bench("parse_street_tags", [&] {
+        {
+            osmium::builder::WayBuilder builder(buffer);
+            osmium::builder::TagListBuilder tl_builder(buffer, &builder);
+            parse_street_tags(&tl_builder, street.feat, &g_link_restrictions, &g_area_to_govt_code_map,
+                    &g_cntry_ref_map);
+        }
+        buffer.clear();
+    });
+
+    g_cdms_map.clear();
+    g_link_restrictions.clear();
+    g_area_to_govt_code_map.clear();
+    g_cntry_ref_map.clear();
+}
+
+/**
+ * \brief benchmarks the splitting of a way at z-level changes.
+ * \param z_lvls z-levels of the nodes of the way as in tests/navteq/test_navteq2osm.cpp.
+ */
+void bench_split_way(street_feature& street, const std::string& z_lvls) {
+    std::vector<short> node_z_lvls;
+    std::istringstream stream(z_lvls);
+    for (short z_lvl; stream >> z_lvl;)
+        node_z_lvls.push_back(z_lvl);
+
+    index_z_lvl_vector_type index_z_lvl_vector;
+    for (size_t i = 0; i < node_z_lvls.size(); i++)
+        if (node_z_lvls.at(i) != 0) index_z_lvl_vector.push_back(index_z_lvl_pair_type(i, node_z_lvls.at(i)));
+
+    std::vector<double> xy = diagonal_line(node_z_lvls.size());
+    polyline_span line(xy.data(), node_z_lvls.size());
+    uint link_id = get_uint_from_feature(street.feat, SF_LINK_ID);
+
+    // nodes are created once like in process_way(), the benchmarks only create ways
+    reset_state();
+    process_z_lvl_end_nodes(line, index_z_lvl_vector);
+    node_map_type node_ref_map;
+    middle_points_preparation(line, node_ref_map);
+    process_end_point(true, get_first_z_lvl(index_z_lvl_vector), line, node_ref_map);
+    process_end_point(false, get_last_z_lvl(index_z_lvl_vector, line.size() - 1), line, node_ref_map);
+
+    bench("split_way_by_z_level [" + z_lvls + "]", [&] {
+        split_way_by_z_level(street.feat, line, index_z_lvl_vector, &node_ref_map, link_id);
+        recycle_buffers();
+    });
+
+    ushort start_index = index_z_lvl_vector.front().first;
+    if (start_index > 0) start_index--;
+    node_ref_vector_type node_refs;
+    resolve_node_refs(line, &node_ref_map, true, node_refs);
+    bench("create_continuing_sub_ways [" + z_lvls + "]", [&] {
+        create_continuing_sub_ways(street.feat, node_ref_span(node_refs), 0, start_index, line.size() - 1, link_id,
+                index_z_lvl_vector);
+        recycle_buffers();
+    });
+}
+
+void bench_process_way_end_node() {
+    // junctions of a grid, each is the end point of two links on average
+    std::vector<osmium::Location> end_points;
+    for (int x = 0; x < 300; x++)
+        for (int y = 0; y < 300; y++)
+            end_points.push_back(osmium::Location(10.0 + 0.001 * x, 50.0 + 0.001 * y));
+    size_t junction_count = end_points.size();
+    end_points.insert(end_points.end(), end_points.begin(), end_points.end());
+    std::shuffle(end_points.begin(), end_points.end(), std::mt19937(1));
+
+    reset_state();
+    size_t next = 0;
+    bench("process_way_end_node", [&] {
+        if (next == end_points.size()) {
+            next = 0;
+            g_way_end_points_map.clear();
+            g_way_end_points_map.reserve(junction_count);
+            g_node_buffer.clear();
+        }
+        process_way_end_node(end_points[next++]);
+        g_node_buffer.commit();
+    });
+}
+
+void bench_create_offset_curve() {
+    OGRLineString street_line;
+    street_line.addPoint(10.000, 10.000);
+    street_line.addPoint(10.001, 10.001);
+    street_line.addPoint(10.002, 10.000);
+    street_line.addPoint(10.003, 10.001);
+    street_line.addPoint(10.004, 10.000);
+
+    // offset of create_house_numbers()
+    geometry_context ctx;
+    bench("create_offset_curve", [&] {
+        ogr_line_string_uptr offset_line(create_offset_curve(ctx, &street_line, 0.00005, true));
+    });
+
+    std::vector<double> street_xy;
+    for (int i = 0; i < street_line.getNumPoints(); i++) {
+        street_xy.push_back(street_line.getX(i));
+        street_xy.push_back(street_line.getY(i));
+    }
+    offset_curve_builder builder;
+    std::vector<double> offset_xy;
+    bench("offset_curve_builder", [&] {
+        builder.build(polyline_span(street_xy.data(), street_line.getNumPoints()), 0.00005, true, offset_xy);
+    });
+}
+
+void bench_geometry_conversion() {
+    // a street and an admin boundary with a hole
+    OGRLineString line;
+    for (int i = 0; i < 100; i++)
+        line.addPoint(10.0 + i * 0.0001, 50.0 + (i % 2) * 0.0001);
+    OGRPolygon polygon;
+    for (int r : { 1000, 100 }) {
+        OGRLinearRing* ring = new OGRLinearRing();
+        double radius = r == 1000 ? 1.0 : 0.1;
+        for (int i = 0; i <= r; i++)
+            ring->addPoint(10.0 + radius * cos(2 * M_PI * (i % r) / r), 50.0 + radius * sin(2 * M_PI * (i % r) / r));
+        polygon.addRingDirectly(ring);
+    }
+
+    geometry_context ctx;
+    for (OGRGeometry* ogr_geom : std::vector<OGRGeometry*> { &line, &polygon }) {
+        std::string name = ogr_geom == &line ? "line_string" : "polygon";
+        bench("ogr2geos " + name + " (wkb)", [&] {
+            std::unique_ptr<geos::geom::Geometry> geos_geom(wkb2geos(ctx, ogr2wkb(ogr_geom)));
+        });
+        bench("ogr2geos " + name, [&] {
+            std::unique_ptr<geos::geom::Geometry> geos_geom(ogr2geos(ctx, ogr_geom));
+        });
+
+        std::unique_ptr<geos::geom::Geometry> geos_geom(ogr2geos(ctx, ogr_geom));
+        bench("geos2ogr " + name + " (wkb)", [&] {
+            std::unique_ptr<OGRGeometry> ogr_result(wkb2ogr(geos2wkb(ctx, geos_geom.get())));
+        });
+        bench("geos2ogr " + name, [&] {
+            std::unique_ptr<OGRGeometry> ogr_result(geos2ogr(ctx, geos_geom.get()));
+        });
+    }
+}
+
+void bench_collect_via_manoeuvre_osm_ids(street_feature& street) {
+    reset_state();
+
+    // three consecutive links, the middle one in reverse direction
+    std::vector<std::vector<double>> lines = { { 10.000, 10.000, 10.001, 10.001, 10.002, 10.002 }, { 10.004, 10.002,
+            10.003, 10.003, 10.002, 10.002 }, { 10.004, 10.002, 10.005, 10.001, 10.006, 10.000 } };
+    link_id_vector_type via_link_ids;
+    link_id_type link_id = 1;
+    for (auto& xy : lines) {
+        polyline_span line(xy.data(), xy.size() / 2);
+        process_way_end_nodes(line);
+        node_map_type node_ref_map;
+        middle_points_preparation(line, node_ref_map);
+        build_way(street.feat, line, &node_ref_map);
+        g_way_buffer.commit();
+        // build_way() registers the way under the link id of the feature
+        g_link_ways.back().link_id = link_id;
+        via_link_ids.push_back(link_id++);
+    }
+    sort_link_ways();
+
+    bench("collect_via_manoeuvre_osm_ids", [&] {
+        osm_id_vector_type osm_ids = collect_via_manoeuvre_osm_ids(via_link_ids);
+        assert(osm_ids.size() == 3);
+    });
+}
+
+void bench_build_admin_boundary_ways() {
+    // ring with more nodes than fit into one way
+    OGRLinearRing ring;
+    int num_points = OSM_MAX_WAY_NODES + OSM_MAX_WAY_NODES / 2;
+    // the last point closes the ring
+    for (int i = 0; i <= num_points; i++)
+        ring.addPoint(10.0 + cos(2 * M_PI * (i % num_points) / num_points),
+                50.0 + sin(2 * M_PI * (i % num_points) / num_points));
+
+    reset_state();
+    bench("build_admin_boundary_ways", [&] {
+        build_admin_boundary_ways(&ring);
+        g_node_buffer.commit();
+        g_way_buffer.commit();
+        recycle_buffers();
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "usage: " << argv[0] << " [FILTER]" << std::endl;
+        return 1;
+    }
+    if (argc == 2) g_filter = argv[1];
+
+    OGRRegisterAll();
+
+    std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(14) << "ns/op" << std::setw(12)
+            << "allocs/op" << std::setw(12) << "ops" << std::endl;
+
+    street_feature street;
+    bench_parse_street_tags(street);
+
+    // z-level patterns of tests/navteq/test_navteq2osm.cpp
+    std::vector<std::string> z_lvl_patterns = { "0 1", "1 0", "1 1", "0 0 1", "0 1 0", "0 1 1", "1 0 0", "1 0 1",
+            "1 1 0", "1 1 1", "-1 0 -1", "-1 1 -1", "1 -1 1", "0 -1 0", "2 1 2", "-2 -1 -2", "-2 -1 -3", "0 0 0 1",
+            "0 0 1 0", "0 0 1 1", "0 1 0 0", "0 1 0 1", "0 1 1 0", "0 1 1 1", "1 0 0 0", "1 0 0 1", "1 0 1 0",
+            "1 0 1 1", "1 1 0 0", "1 1 0 1", "1 1 1 0", "1 1 1 1", "1 2 2 1", "2 1 1 2", "1 0 0 0 1", "2 1 0 1 2",
+            "2 1 0 0 1 2", "0 1 1 0 1 1 0", "0 1 0 1 0 1 0 1", "0 1 1 0 0 1 0 0", "1 0 1 0 1 0 1 0",
+            "0 1 0 1 0 0 1 0 1", "0 1 1 0 1 1 0 1 1 0", "0 4 4 0 0 0 5 5 0 0" };
+    for (auto& z_lvls : z_lvl_patterns)
+        bench_split_way(street, z_lvls);
+
+    bench_process_way_end_node();
+    bench_create_offset_curve();
+    bench_geometry_conversion();
+    bench_collect_via_manoeuvre_osm_ids(street);
+    bench_build_admin_boundary_ways();
+
+    reset_state();
+}
@@ -0,0 +1,622 @@
+/*
+ * create_navstreets.cpp
+ *
+ * Creates a synthetic NAVSTREETS dataset of a chosen size for benchmarks.
+ *
+ * Links form a grid of streets with jittered shape points. Every 40th row
+ * is an elevated motorway (z-level 1) which crosses the streets below
+ * without junctions, some links are bridges or tunnels with z-levels at
+ * their inner points. About 2% of the junctions get a restricted driving
+ * manoeuvre, about 1% of the links a height or weight restriction and
+ * residential links have house number ranges. Administrative boundaries
+ * divide the grid into 2^(level-1) x 2^(level-1) areas per level.
+ *
+ * The output only depends on the number of links and the seed.
+ */
+
+#include <getopt.h>
+#include <sys/stat.h>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <shapefil.h>
+
+static constexpr double ORIGIN_X = 10.0;
+static constexpr double ORIGIN_Y = 50.0;
+// distance of neighbouring junctions in degrees
+static constexpr double GRID_STEP = 0.001;
+
+static constexpr int LINK_ID_BASE = 100000000;
+static constexpr int NODE_ID_BASE = 500000000;
+static constexpr int FEAT_ID_BASE = 700000000;
+static constexpr int POLYGON_ID_BASE = 900000000;
+static constexpr uint64_t MAX_LINKS = 200000000;
+
+// every ELEVATED_ROW_INTERVAL-th row is an elevated motorway
+static constexpr uint64_t ELEVATED_ROW_INTERVAL = 40;
+static constexpr int ADMIN_LVL_COUNT = 5;
+static constexpr int GOVT_CODE = 999;
+
+// from navteq_mappings.hpp
+static constexpr int RESTRICTED_DRIVING_MANOEUVRE = 7;
+static constexpr int CT_TRANSPORT_ACCESS_RESTRICTION = 23;
+static constexpr int MT_HEIGHT_RESTRICTION = 41;
+static constexpr int MT_WEIGHT_RESTRICTION = 42;
+
+/**
+ * \brief splitmix64, cheap enough to be seeded for every link.
+ */
+class random_sequence {
+    uint64_t state;
+
+public:
+    random_sequence(uint64_t seed, uint64_t stream) :
+            state(seed * 0x9e3779b97f4a7c15ULL ^ (stream + 1) * 0xbf58476d1ce4e5b9ULL) {
+    }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [0, 1)
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    bool chance(double probability) {
+        return uniform() < probability;
+    }
+
+    int range(int min, int max) {
+        return min + next() % (max - min + 1);
+    }
+};
+
+struct dbf_field {
+    const char* name;
+    DBFFieldType type;
+    int width;
+};
+
+/**
+ * \brief Writes DBF records field by field in the order of the fields.
+ */
+class dbf_writer {
+    DBFHandle handle;
+    int field_count;
+    int record;
+    int field;
+
+    void check(int result) {
+        if (!result) throw std::runtime_error("could not write DBF record " + std::to_string(record));
+        field++;
+    }
+
+public:
+    dbf_writer(const std::string& path, std::initializer_list<dbf_field> fields) :
+            handle(DBFCreate(path.c_str())), field_count(fields.size()), record(0), field(0) {
+        if (!handle) throw std::runtime_error("could not create " + path);
+        for (auto& f : fields)
+            if (DBFAddField(handle, f.name, f.type, f.width, 0) == -1)
+                throw std::runtime_error("could not add field " + std::string(f.name) + " to " + path);
+    }
+
+    ~dbf_writer() {
+        DBFClose(handle);
+    }
+
+    dbf_writer(const dbf_writer&) = delete;
+    dbf_writer& operator=(const dbf_writer&) = delete;
+
+    dbf_writer& operator<<(const char* value) {
+        assert(field < field_count);
+        check(DBFWriteStringAttribute(handle, record, field, value));
+        return *this;
+    }
+
+    dbf_writer& operator<<(const std::string& value) {
+        return *this << value.c_str();
+    }
+
+    dbf_writer& operator<<(int value) {
+        assert(field < field_count);
+        check(DBFWriteIntegerAttribute(handle, record, field, value));
+        return *this;
+    }
+
+    void end_record() {
+        assert(field == field_count);
+        record++;
+        field = 0;
+    }
+
+    int record_count() const {
+        return record;
+    }
+};
+
+/**
+ * \brief Shapefile of one geometry type with its attribute table.
+ */
+class shape_writer {
+    SHPHandle handle;
+
+public:
+    dbf_writer dbf;
+
+    shape_writer(const std::string& base_name, int shape_type, std::initializer_list<dbf_field> fields) :
+            handle(SHPCreate(base_name.c_str(), shape_type)), dbf(base_name + ".dbf", fields) {
+        if (!handle) throw std::runtime_error("could not create " + base_name + ".shp");
+    }
+
+    ~shape_writer() {
+        SHPClose(handle);
+    }
+
+    shape_writer(const shape_writer&) = delete;
+    shape_writer& operator=(const shape_writer&) = delete;
+
+    void write(int shape_type, const std::vector<double>& x, const std::vector<double>& y) {
+        SHPObject* shape = SHPCreateSimpleObject(shape_type, x.size(), x.data(), y.data(), nullptr);
+        int id = SHPWriteObject(handle, -1, shape);
+        SHPDestroyObject(shape);
+        if (id < 0) throw std::runtime_error("could not write shape");
+    }
+};
+
+/**
+ * \brief Grid of junctions (cols x rows) and the links between them.
+ *
+ *        Links are numbered row by row. Each row has cols - 1 horizontal links
+ *        followed by cols vertical links to the next row.
+ */
+struct street_grid {
+    uint64_t cols;
+    uint64_t rows;
+    uint64_t links;
+
+    explicit street_grid(uint64_t links) :
+            links(links) {
+        cols = std::max<uint64_t>(2, std::llround(std::sqrt(links / 2.0)));
+        rows = (links + links_per_row() - 1) / links_per_row() + 1;
+    }
+
+    uint64_t links_per_row() const {
+        return 2 * cols - 1;
+    }
+
+    bool is_horizontal(uint64_t link) const {
+        return link % links_per_row() < cols - 1;
+    }
+
+    uint64_t start_col(uint64_t link) const {
+        uint64_t i = link % links_per_row();
+        return is_horizontal(link) ? i : i - (cols - 1);
+    }
+
+    uint64_t start_row(uint64_t link) const {
+        return link / links_per_row();
+    }
+
+    uint64_t end_col(uint64_t link) const {
+        return start_col(link) + (is_horizontal(link) ? 1 : 0);
+    }
+
+    uint64_t end_row(uint64_t link) const {
+        return start_row(link) + (is_horizontal(link) ? 0 : 1);
+    }
+
+    // number of the link from junction (col, row) to (col + 1, row)
+    uint64_t horizontal_link(uint64_t col, uint64_t row) const {
+        return row * links_per_row() + col;
+    }
+
+    bool is_elevated(uint64_t link) const {
+        return is_horizontal(link) && is_elevated_row(start_row(link));
+    }
+
+    static bool is_elevated_row(uint64_t row) {
+        return row % ELEVATED_ROW_INTERVAL == ELEVATED_ROW_INTERVAL / 2;
+    }
+
+    int node_id(uint64_t col, uint64_t row) const {
+        return NODE_ID_BASE + row * cols + col;
+    }
+
+    static double x(double col) {
+        return std::round((ORIGIN_X + col * GRID_STEP) * 1e7) / 1e7;
+    }
+
+    static double y(double row) {
+        return std::round((ORIGIN_Y + row * GRID_STEP) * 1e7) / 1e7;
+    }
+
+    // number of areas per axis on admin level
+    static uint64_t areas_per_axis(int admin_lvl) {
+        return 1 << (admin_lvl - 1);
+    }
+
+    int area_id(int admin_lvl, uint64_t area_x, uint64_t area_y) const {
+        return admin_lvl * 1000000 + area_y * areas_per_axis(admin_lvl) + area_x;
+    }
+
+    // id of the smallest area containing junction (col, row)
+    int area_id_of(uint64_t col, uint64_t row) const {
+        uint64_t n = areas_per_axis(ADMIN_LVL_COUNT);
+        return area_id(ADMIN_LVL_COUNT, col * n / cols, row * n / rows);
+    }
+};
+
+/**
+ * \brief attributes of a link which are derived from its position in the grid.
+ */
+struct link_attributes {
+    int func_class;
+    bool bridge = false;
+    bool tunnel = false;
+    bool ferry = false;
+    bool pedestrian = false;
+    bool one_way = false;
+    bool house_numbers = false;
+    // z-level of the inner shape points (and of the end points for elevated links)
+    int z_lvl = 0;
+    bool elevated = false;
+    std::vector<double> x, y;
+};
+
+link_attributes create_link(const street_grid& grid, uint64_t link, uint64_t seed) {
+    random_sequence random(seed, link);
+    link_attributes a;
+
+    uint64_t line = grid.is_horizontal(link) ? grid.start_row(link) : grid.start_col(link);
+    a.elevated = grid.is_elevated(link);
+    if (a.elevated) a.func_class = 1;
+    else if (line % 50 == 0) a.func_class = 2;
+    else if (line % 10 == 0) a.func_class = 3;
+    else if (line % 5 == 0) a.func_class = 4;
+    else a.func_class = 5;
+
+    // shape points between the junctions, jittered across the link
+    int inner_points = random.range(0, 3);
+    double x0 = grid.start_col(link), y0 = grid.start_row(link);
+    double dx = grid.end_col(link) - x0, dy = grid.end_row(link) - y0;
+    a.x.push_back(street_grid::x(x0));
+    a.y.push_back(street_grid::y(y0));
+    for (int i = 1; i <= inner_points; i++) {
+        double t = double(i) / (inner_points + 1);
+        double offset = (random.uniform() - 0.5) * 0.4;
+        a.x.push_back(street_grid::x(x0 + dx * t + dy * offset));
+        a.y.push_back(street_grid::y(y0 + dy * t + dx * offset));
+    }
+    a.x.push_back(street_grid::x(x0 + dx));
+    a.y.push_back(street_grid::y(y0 + dy));
+
+    if (a.elevated) {
+        a.z_lvl = 1;
+        a.bridge = random.chance(0.25);
+    } else if (inner_points > 0 && random.chance(0.02)) {
+        a.bridge = true;
+        a.z_lvl = 1;
+    } else if (inner_points > 0 && random.chance(0.01)) {
+        a.tunnel = true;
+        a.z_lvl = -1;
+    } else if (a.func_class == 5) {
+        a.ferry = random.chance(0.001);
+        a.pedestrian = !a.ferry && random.chance(0.01);
+        a.one_way = random.chance(0.05);
+        a.house_numbers = random.chance(0.4);
+    }
+    if (a.elevated) a.one_way = grid.start_row(link) % 2;
+    return a;
+}
+
+/**
+ * \brief NAVSTREETS tables of one region directory.
+ */
+struct region_writer {
+    shape_writer streets;
+    shape_writer zlevels;
+    dbf_writer rdms;
+    dbf_writer cdms;
+    dbf_writer cnd_mod;
+    int cond_id;
+
+    region_writer(const std::string& dir, int first_cond_id) :
+            streets(dir + "/Streets", SHPT_ARC, {
+                { "LINK_ID", FTInteger, 10 }, { "ST_NAME", FTString, 80 }, { "FEAT_ID", FTInteger, 10 },
+                { "ST_LANGCD", FTString, 3 }, { "NUM_STNMES", FTInteger, 2 }, { "ADDR_TYPE", FTString, 1 },
+                { "L_REFADDR", FTString, 10 }, { "L_NREFADDR", FTString, 10 }, { "L_ADDRSCH", FTString, 1 },
+                { "L_ADDRFORM", FTString, 2 }, { "R_REFADDR", FTString, 10 }, { "R_NREFADDR", FTString, 10 },
+                { "R_ADDRSCH", FTString, 1 }, { "R_ADDRFORM", FTString, 2 }, { "REF_IN_ID", FTInteger, 10 },
+                { "NREF_IN_ID", FTInteger, 10 }, { "N_SHAPEPNT", FTInteger, 5 }, { "FUNC_CLASS", FTString, 1 },
+                { "SPEED_CAT", FTString, 1 }, { "FR_SPD_LIM", FTInteger, 5 }, { "TO_SPD_LIM", FTInteger, 5 },
+                { "TO_LANES", FTInteger, 2 }, { "FROM_LANES", FTInteger, 2 }, { "DIR_TRAVEL", FTString, 1 },
+                { "L_AREA_ID", FTInteger, 10 }, { "R_AREA_ID", FTInteger, 10 }, { "L_POSTCODE", FTString, 11 },
+                { "R_POSTCODE", FTString, 11 }, { "AR_AUTO", FTString, 1 }, { "AR_BUS", FTString, 1 },
+                { "AR_TAXIS", FTString, 1 }, { "AR_CARPOOL", FTString, 1 }, { "AR_PEDEST", FTString, 1 },
+                { "AR_TRUCKS", FTString, 1 }, { "AR_TRAFF", FTString, 1 }, { "AR_DELIV", FTString, 1 },
+                { "AR_EMERVEH", FTString, 1 }, { "AR_MOTOR", FTString, 1 }, { "PAVED", FTString, 1 },
+                { "PRIVATE", FTString, 1 }, { "BRIDGE", FTString, 1 }, { "TUNNEL", FTString, 1 },
+                { "RAMP", FTString, 1 }, { "TOLLWAY", FTString, 1 }, { "ROUNDABOUT", FTString, 1 },
+                { "FERRY_TYPE", FTString, 1 }, { "URBAN", FTString, 1 }, { "ROUTE_TYPE", FTString, 1 },
+                { "FOURWHLDR", FTString, 1 }, { "PHYS_LANES", FTInteger, 2 }, { "PUB_ACCESS", FTString, 1 } }),
+            zlevels(dir + "/Zlevels", SHPT_POINT, {
+                { "LINK_ID", FTInteger, 10 }, { "POINT_NUM", FTInteger, 5 }, { "NODE_ID", FTInteger, 10 },
+                { "Z_LEVEL", FTInteger, 2 }, { "INTRSECT", FTString, 1 }, { "DOT_SHAPE", FTString, 1 },
+                { "ALIGNED", FTString, 1 } }),
+            rdms(dir + "/Rdms.dbf", {
+                { "LINK_ID", FTInteger, 10 }, { "COND_ID", FTInteger, 10 }, { "MAN_LINKID", FTInteger, 10 },
+                { "SEQ_NUMBER", FTInteger, 2 } }),
+            cdms(dir + "/Cdms.dbf", {
+                { "LINK_ID", FTInteger, 10 }, { "COND_ID", FTInteger, 10 }, { "COND_TYPE", FTInteger, 2 },
+                { "END_OF_LK", FTString, 1 } }),
+            cnd_mod(dir + "/CndMod.dbf", {
+                { "COND_ID", FTInteger, 10 }, { "LANG_CODE", FTString, 3 }, { "MOD_TYPE", FTInteger, 5 },
+                { "MOD_VAL", FTInteger, 10 } }),
+            cond_id(first_cond_id) {
+    }
+};
+
+const char* yes_no(bool value) {
+    return value ? "Y" : "N";
+}
+
+std::string postcode(const street_grid& grid, uint64_t col, uint64_t row) {
+    return std::to_string(10000 + grid.area_id_of(col, row) % 1000000);
+}
+
+void write_street(region_writer& region, const street_grid& grid, uint64_t link, const link_attributes& a) {
+    static const int speed_limits[] = { 0, 110, 90, 70, 50, 30 };
+    static const char* speed_cats[] = { "", "2", "3", "5", "6", "7" };
+
+    uint64_t col = grid.start_col(link), row = grid.start_row(link);
+    std::string name = a.elevated ? "E" + std::to_string(row) :
+                       grid.is_horizontal(link) ? "AVENUE " + std::to_string(row) : "STREET " + std::to_string(col);
+    int speed_limit = a.ferry ? 0 : speed_limits[a.func_class];
+    int lanes = a.func_class <= 2 ? 2 : 1;
+    int area_id = grid.area_id_of(col, row);
+    std::string first_number = std::to_string(1 + 2 * (col + row) % 200);
+    std::string last_number = std::to_string(19 + 2 * (col + row) % 200);
+    bool vehicles = !a.pedestrian;
+
+    dbf_writer& dbf = region.streets.dbf;
+    dbf << LINK_ID_BASE + int(link) << name << FEAT_ID_BASE + int(link) << "ENG" << 1;
+    dbf << (a.house_numbers ? "B" : "");
+    if (a.house_numbers) {
+        dbf << first_number << last_number << "O" << "N" << std::to_string(std::stoi(first_number) + 1)
+                << std::to_string(std::stoi(last_number) + 1) << "E" << "N";
+    } else {
+        dbf << "" << "" << "" << "" << "" << "" << "" << "";
+    }
+    dbf << grid.node_id(col, row) << grid.node_id(grid.end_col(link), grid.end_row(link)) << int(a.x.size() - 2);
+    dbf << std::to_string(a.func_class) << speed_cats[a.func_class];
+    dbf << speed_limit << (a.one_way ? 0 : speed_limit) << (a.one_way ? 0 : lanes) << lanes;
+    dbf << (a.one_way ? "F" : "B") << area_id << area_id << postcode(grid, col, row) << postcode(grid, col, row);
+    // AR_AUTO, AR_BUS, AR_TAXIS, AR_CARPOOL, AR_PEDEST, AR_TRUCKS, AR_TRAFF, AR_DELIV, AR_EMERVEH, AR_MOTOR
+    dbf << yes_no(vehicles) << yes_no(vehicles) << yes_no(vehicles) << yes_no(vehicles)
+            << yes_no(a.func_class > 1) << yes_no(vehicles) << yes_no(vehicles) << yes_no(vehicles)
+            << yes_no(vehicles) << yes_no(vehicles);
+    dbf << yes_no(a.func_class < 5 || (link % 20)) << yes_no(a.func_class == 5 && link % 100 == 1)
+            << yes_no(a.bridge) << yes_no(a.tunnel) << "N" << yes_no(a.elevated && row % 3 == 0) << "N";
+    dbf << (a.ferry ? "B" : "H") << yes_no(a.func_class > 1) << (a.elevated ? "1" : "") << "N" << lanes << "Y";
+    dbf.end_record();
+
+    region.streets.write(SHPT_ARC, a.x, a.y);
+}
+
+void write_z_levels(region_writer& region, const street_grid& grid, uint64_t link, const link_attributes& a) {
+    if (!a.z_lvl) return;
+    int last = a.x.size() - 1;
+    for (int i = 0; i <= last; i++) {
+        bool end_point = i == 0 || i == last;
+        int node_id = 0;
+        if (i == 0) node_id = grid.node_id(grid.start_col(link), grid.start_row(link));
+        else if (i == last) node_id = grid.node_id(grid.end_col(link), grid.end_row(link));
+        // bridges and tunnels are connected to the ground, elevated motorways only to each other
+        int z_lvl = end_point && !a.elevated ? 0 : a.z_lvl;
+        region.zlevels.dbf << LINK_ID_BASE + int(link) << i + 1 << node_id << z_lvl << yes_no(end_point) << "N"
+                << "N";
+        region.zlevels.dbf.end_record();
+        region.zlevels.write(SHPT_POINT, { a.x.at(i) }, { a.y.at(i) });
+    }
+}
+
+/**
+ * \brief adds a height or weight restriction to about 1% of the links.
+ */
+void write_access_restriction(region_writer& region, uint64_t link, uint64_t seed) {
+    random_sequence random(seed ^ 0xacce55, link);
+    if (!random.chance(0.01)) return;
+    int cond_id = region.cond_id++;
+    region.cdms << LINK_ID_BASE + int(link) << cond_id << CT_TRANSPORT_ACCESS_RESTRICTION << "N";
+    region.cdms.end_record();
+    if (random.chance(0.5)) region.cnd_mod << cond_id << "ENG" << MT_HEIGHT_RESTRICTION << random.range(300, 450);
+    else region.cnd_mod << cond_id << "ENG" << MT_WEIGHT_RESTRICTION << 1000 * random.range(3, 12);
+    region.cnd_mod.end_record();
+}
+
+/**
+ * \brief forbids turning from the horizontal link ending at the start of the vertical link into it
+ *        at about 2% of the junctions.
+ */
+void write_manoeuvre(region_writer& region, const street_grid& grid, uint64_t link, uint64_t seed) {
+    if (grid.is_horizontal(link)) return;
+    uint64_t col = grid.start_col(link), row = grid.start_row(link);
+    if (col == 0 || street_grid::is_elevated_row(row)) return;
+    random_sequence random(seed ^ 0x7e57, link);
+    if (!random.chance(0.02)) return;
+
+    int cond_id = region.cond_id++;
+    uint64_t from_link = grid.horizontal_link(col - 1, row);
+    region.rdms << LINK_ID_BASE + int(from_link) << cond_id << LINK_ID_BASE + int(link) << 1;
+    region.rdms.end_record();
+    region.cdms << LINK_ID_BASE + int(from_link) << cond_id << RESTRICTED_DRIVING_MANOEUVRE << "N";
+    region.cdms.end_record();
+}
+
+/**
+ * \brief writes the administrative areas, their boundaries and the country reference.
+ *        Areas are only written to the first region, the other regions get empty tables.
+ */
+void write_admin_areas(const std::string& dir, const street_grid& grid, bool first_region) {
+    dbf_writer mtd_area(dir + "/MtdArea.dbf", {
+        { "AREA_ID", FTInteger, 10 }, { "AREACODE_1", FTInteger, 3 }, { "LANG_CODE", FTString, 3 },
+        { "AREA_NAME", FTString, 35 }, { "AREA_TYPE", FTString, 1 }, { "ADMIN_LVL", FTInteger, 1 },
+        { "GOVT_CODE", FTInteger, 3 } });
+    dbf_writer cntry_ref(dir + "/MtdCntryRef.dbf", {
+        { "GOVT_CODE", FTInteger, 3 }, { "ISO_CODE", FTString, 3 }, { "UNTMEASURE", FTString, 1 },
+        { "SPDLIMUNIT", FTString, 3 }, { "MAX_ADMINL", FTInteger, 1 } });
+    if (!first_region) return;
+
+    cntry_ref << GOVT_CODE << "ZZZ" << "M" << "KPH" << ADMIN_LVL_COUNT;
+    cntry_ref.end_record();
+
+    double min_x = -0.5, min_y = -0.5;
+    double width = grid.cols, height = grid.rows;
+    for (int admin_lvl = 1; admin_lvl <= ADMIN_LVL_COUNT; admin_lvl++) {
+        std::string base_name = dir + "/Adminbndy" + std::to_string(admin_lvl);
+        shape_writer adminbndy(base_name, SHPT_POLYGON, {
+            { "POLYGON_ID", FTInteger, 10 }, { "AREA_ID", FTInteger, 10 }, { "FEAT_TYPE", FTInteger, 6 } });
+        uint64_t n = street_grid::areas_per_axis(admin_lvl);
+        for (uint64_t area_y = 0; area_y < n; area_y++) {
+            for (uint64_t area_x = 0; area_x < n; area_x++) {
+                int area_id = grid.area_id(admin_lvl, area_x, area_y);
+                std::string name = "AREA " + std::to_string(admin_lvl) + " " + std::to_string(area_x) + " "
+                        + std::to_string(area_y);
+                mtd_area << area_id << 1 << "ENG" << name << "B" << admin_lvl << GOVT_CODE;
+                mtd_area.end_record();
+                if (admin_lvl <= 2) {
+                    mtd_area << area_id << 1 << "GER" << "GEBIET " + name.substr(5) << "B" << admin_lvl << GOVT_CODE;
+                    mtd_area.end_record();
+                }
+
+                // rectangle with a vertex per grid step, clockwise as required for outer rings
+                double x0 = min_x + width * area_x / n, x1 = min_x + width * (area_x + 1) / n;
+                double y0 = min_y + height * area_y / n, y1 = min_y + height * (area_y + 1) / n;
+                std::vector<double> x, y;
+                auto add_edge = [&](double from_x, double from_y, double to_x, double to_y) {
+                    int steps = std::max(1.0, std::ceil(std::max(std::fabs(to_x - from_x), std::fabs(to_y - from_y))));
+                    for (int i = 0; i < steps; i++) {
+                        x.push_back(street_grid::x(from_x + (to_x - from_x) * i / steps));
+                        y.push_back(street_grid::y(from_y + (to_y - from_y) * i / steps));
+                    }
+                };
+                add_edge(x0, y0, x0, y1);
+                add_edge(x0, y1, x1, y1);
+                add_edge(x1, y1, x1, y0);
+                add_edge(x1, y0, x0, y0);
+                x.push_back(x.front());
+                y.push_back(y.front());
+
+                adminbndy.dbf << POLYGON_ID_BASE + area_id << area_id << 900100 + admin_lvl;
+                adminbndy.dbf.end_record();
+                adminbndy.write(SHPT_POLYGON, x, y);
+            }
+        }
+    }
+}
+
+void create_directory(const std::string& dir) {
+    if (mkdir(dir.c_str(), 0755) && errno != EEXIST) throw std::runtime_error("could not create directory " + dir);
+}
+
+void print_help() {
+    std::cout << "create_navstreets [OPTIONS] DIR\n\n"
+            << "Creates a synthetic NAVSTREETS dataset in DIR.\n"
+            << "\nOptions:\n"
+            << "  -h, --help                This help message\n"
+            << "  -l, --links=N             Number of links (default: 10000)\n"
+            << "  -r, --region-links=N      Maximum number of links per region directory (default: 4000000)\n"
+            << "  -s, --seed=N              Seed of the random attributes (default: 1)\n";
+}
+
+uint64_t parse_count(const char* arg, const char* what) {
+    char* end;
+    long long value = strtoll(arg, &end, 10);
+    if (*end || value < 1) {
+        std::cerr << "invalid " << what << ": " << arg << std::endl;
+        exit(1);
+    }
+    return value;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t links = 10000;
+    uint64_t region_links = 4000000;
+    uint64_t seed = 1;
+
+    static struct option long_options[] = { { "help", no_argument, 0, 'h' }, { "links", required_argument, 0, 'l' },
+            { "region-links", required_argument, 0, 'r' }, { "seed", required_argument, 0, 's' }, { 0, 0 } };
+    while (true) {
+        int c = getopt_long(argc, argv, "hl:r:s:", long_options, 0);
+        if (c == -1) break;
+        switch (c) {
+            case 'h':
+                print_help();
+                exit(0);
+            case 'l':
+                links = parse_count(optarg, "number of links");
+                break;
+            case 'r':
+                region_links = parse_count(optarg, "number of links per region");
+                break;
+            case 's':
+                seed = parse_count(optarg, "seed");
+                break;
+            default:
+                exit(1);
+        }
+    }
+    if (argc - optind != 1) {
+        std::cerr << "Usage: " << argv[0] << " [OPTIONS] DIR" << std::endl;
+        exit(1);
+    }
+    std::string dir = argv[optind];
+    // keeps the ids of links, nodes and features apart
+    if (links > MAX_LINKS) {
+        std::cerr << "too many links: " << links << " (maximum: " << MAX_LINKS << ")" << std::endl;
+        exit(1);
+    }
+
+    street_grid grid(links);
+    uint64_t regions = (links + region_links - 1) / region_links;
+    std::cout << "creating " << links << " links on a grid of " << grid.cols << "x" << grid.rows << " junctions in "
+            << regions << " region(s)" << std::endl;
+
+    create_directory(dir);
+    for (uint64_t r = 0; r < regions; r++) {
+        std::string region_dir = dir;
+        if (regions > 1) {
+            region_dir += "/region_" + std::to_string(r);
+            create_directory(region_dir);
+        }
+        write_admin_areas(region_dir, grid, r == 0);
+
+        // condition ids are unique over all regions, links have at most two conditions
+        region_writer region(region_dir, 1 + 2 * r * region_links);
+        uint64_t end = std::min(links, (r + 1) * region_links);
+        for (uint64_t link = r * region_links; link < end; link++) {
+            link_attributes a = create_link(grid, link, seed);
+            write_street(region, grid, link, a);
+            write_z_levels(region, grid, link, a);
+            write_access_restriction(region, link, seed);
+            write_manoeuvre(region, grid, link, seed);
+        }
+        std::cout << region_dir << ": " << region.streets.dbf.record_count() << " links, "
+                << region.zlevels.dbf.record_count() << " z-levels, " << region.rdms.record_count()
+                << " manoeuvres, " << region.cnd_mod.record_count() << " access restrictions" << std::endl;
+    }
+}
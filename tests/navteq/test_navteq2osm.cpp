@@ -1,6 +1,8 @@
 #define CATCH_CONFIG_MAIN
 #include "../catch.hpp"
 
+#include <sstream>
+
 #include "../../plugins/navteq/navteq.hpp"
 #include "../../plugins/navteq/navteq_plugin.hpp"
 
@@ -148,3 +150,72 @@ TEST_CASE("split subway", "[split subway]") {
 
     }
 }
+
+/**
+ * \brief describes the objects of buffer, one string per object.
+ */
+std::vector<std::string> describe_objects(osmium::memory::Buffer& buffer) {
+    std::vector<std::string> objects;
+    for (auto& it : buffer) {
+        osmium::OSMObject* obj = static_cast<osmium::OSMObject*>(&it);
+        std::ostringstream s;
+        s << osmium::item_type_to_char(obj->type()) << obj->id();
+        if (obj->type() == osmium::item_type::node) s << " " << static_cast<osmium::Node*>(obj)->location();
+        if (obj->type() == osmium::item_type::way)
+            for (auto& node_ref : static_cast<osmium::Way*>(obj)->nodes())
+                s << " n" << node_ref.ref();
+        for (auto& tag : obj->tags())
+            s << " " << tag.key() << "=" << tag.value();
+        objects.push_back(s.str());
+    }
+    return objects;
+}
+
+struct street_conversion {
+    std::vector<std::string> nodes;
+    std::vector<std::string> ways;
+    std::vector<std::string> link_ways;
+    osmium::unsigned_object_id_type end_osm_id;
+};
+
+street_conversion convert_streets(const std::string& dir, unsigned int threads) {
+    add_street_shapes(path_vector_type(1, dir), true, threads);
+    street_conversion result;
+    result.nodes = describe_objects(g_node_buffer);
+    result.ways = describe_objects(g_way_buffer);
+    for (auto& link : g_link_ways)
+        result.link_ways.push_back(
+                std::to_string(link.link_id) + " w" + std::to_string(link.first_way_id) + "-"
+                        + std::to_string(link.last_way_id) + " n" + std::to_string(link.front.ref()) + "-"
+                        + std::to_string(link.back.ref()));
+    result.end_osm_id = g_osm_id;
+    clear_all();
+    return result;
+}
+
+TEST_CASE("Street pipeline", "[street_pipeline]") {
+    OGRRegisterAll();
+    std::string navstreets_dir = tmp_dir + "navstreets";
+    system_s("mkdir -p " + tmp_dir);
+    // a few batches of STREET_BATCH_SIZE links with z-levels and restrictions
+    system_s("./tests/create_navstreets --links=5000 " + navstreets_dir + " > /dev/null");
+    REQUIRE(count_street_features(path_vector_type(1, navstreets_dir)) > 4 * STREET_BATCH_SIZE);
+
+    clear_all();
+    street_conversion single = convert_streets(navstreets_dir, 1);
+    for (unsigned int threads : { 2, 4 }) {
+        CAPTURE(threads);
+        street_conversion multi = convert_streets(navstreets_dir, threads);
+        // the pipeline creates the same objects in the same order
+        REQUIRE(multi.nodes.size() == single.nodes.size());
+        for (size_t i = 0; i < single.nodes.size(); i++)
+            if (multi.nodes.at(i) != single.nodes.at(i)) FAIL(multi.nodes.at(i) << " != " << single.nodes.at(i));
+        REQUIRE(multi.ways.size() == single.ways.size());
+        for (size_t i = 0; i < single.ways.size(); i++)
+            if (multi.ways.at(i) != single.ways.at(i)) FAIL(multi.ways.at(i) << " != " << single.ways.at(i));
+        CHECK(multi.link_ways == single.link_ways);
+        CHECK(multi.end_osm_id == single.end_osm_id);
+    }
+
+    system_s("rm -rf " + navstreets_dir);
+}
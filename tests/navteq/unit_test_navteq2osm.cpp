@@ -39,3 +39,425 @@ TEST_CASE("Create way for administrative boundaries", "[admin_ways]") {
     }
 }
 
+
+TEST_CASE("Collect ways of turn restrictions", "[link_ways]") {
+    osmium::Location a(0.0, 0.0), b(1.0, 0.0), c(2.0, 0.0), d(3.0, 0.0);
+    // link 10: a -> b in two ways, link 20: c -> b, link 30: c -> d
+    add_link_way(10, 1, osmium::NodeRef(100, a), osmium::NodeRef(102, osmium::Location(0.5, 0.0)));
+    add_link_way(10, 2, osmium::NodeRef(102, osmium::Location(0.5, 0.0)), osmium::NodeRef(101, b));
+    add_link_way(30, 7, osmium::NodeRef(103, c), osmium::NodeRef(104, d));
+    add_link_way(20, 5, osmium::NodeRef(103, c), osmium::NodeRef(101, b));
+    sort_link_ways();
+
+    REQUIRE(find_link_ways(10));
+    CHECK(find_link_ways(10)->first_way_id == 1);
+    CHECK(find_link_ways(10)->last_way_id == 2);
+    CHECK(find_link_ways(10)->back.ref() == 101);
+    CHECK(!find_link_ways(15));
+
+    CHECK(collect_via_manoeuvre_osm_ids( { 10, 20, 30 }) == osm_id_vector_type( { 1, 2, 5, 7 }));
+    CHECK(collect_via_manoeuvre_osm_ids( { 30, 20, 10 }) == osm_id_vector_type( { 7, 5, 2, 1 }));
+    CHECK(collect_via_manoeuvre_osm_ids( { 10, 15 }).empty());
+
+    clear_all();
+}
+
+TEST_CASE("Resolve nodes of sub ways", "[node_refs]") {
+    std::vector<double> xy = { 0.0, 0.0, 1.0, 0.0, 2.0, 0.0 };
+    polyline_span line(xy.data(), 3);
+    // the first end point has a z-level, the last one is shared with other links
+    node_map_type node_ref_map = { { line.location(0), 10 }, { line.location(1), 11 } };
+    g_way_end_points_map.insert(line.location(2), 12);
+
+    node_ref_vector_type node_refs;
+    resolve_node_refs(line, &node_ref_map, true, node_refs);
+    REQUIRE(node_refs.size() == 3);
+    node_ref_span tail = node_ref_span(node_refs).sub(1, 2);
+    CHECK(tail.size() == 2);
+    CHECK(tail.front().ref() == 11);
+    CHECK(tail.back().ref() == 12);
+    CHECK(tail.back().location() == line.location(2));
+    CHECK(node_ref_span(node_refs).front().ref() == 10);
+
+    g_way_end_points_map.clear();
+}
+
+TEST_CASE("Index of conditional driving manoeuvres", "[cdms_index]") {
+    cdms_index cdms;
+    cdms.add(20, 3, RESTRICTED_DRIVING_MANOEUVRE);
+    cdms.add(10, 2, CT_TRANSPORT_ACCESS_RESTRICTION);
+    cdms.add(20, 1, CT_TRANSPORT_ACCESS_RESTRICTION);
+    cdms.add(30, 3, CT_TRANSPORT_ACCESS_RESTRICTION);
+    cdms.sort();
+
+    CHECK(cdms.size() == 4);
+    auto conditions = cdms.conditions(20);
+    CHECK(std::vector<cond_id_type>(conditions.begin(), conditions.end()) == std::vector<cond_id_type>( { 3, 1 }));
+    CHECK(cdms.conditions(15).size() == 0);
+
+    REQUIRE(cdms.find_cond_type(3));
+    // the first row of a condition determines its type
+    CHECK(*cdms.find_cond_type(3) == RESTRICTED_DRIVING_MANOEUVRE);
+    CHECK(*cdms.find_cond_type(2) == CT_TRANSPORT_ACCESS_RESTRICTION);
+    CHECK(!cdms.find_cond_type(4));
+}
+
+TEST_CASE("Index of z-levels", "[z_lvl_index]") {
+    z_lvl_index z_lvls;
+    z_lvls.add(30, index_z_lvl_vector_type( { { 0, 1 }, { 1, 1 } }));
+    z_lvls.add(10, index_z_lvl_vector_type( { { 2, -1 } }));
+    z_lvls.add(20, index_z_lvl_vector_type());
+    z_lvls.add(30, index_z_lvl_vector_type( { { 4, 2 } }));
+    z_lvls.sort();
+
+    CHECK(z_lvls.size() == 2);
+    z_lvl_range range = z_lvls.find(30);
+    // the first z-levels of a link win
+    CHECK(index_z_lvl_vector_type(range.begin(), range.end()) == index_z_lvl_vector_type( { { 0, 1 }, { 1, 1 } }));
+    CHECK(z_lvls.find(10).at(0) == index_z_lvl_pair_type(2, -1));
+    CHECK(z_lvls.find(20).empty());
+    size_t found = 0;
+    for (link_id_type link_id = 40; link_id < 10000; link_id++)
+        if (!z_lvls.find(link_id).empty()) found++;
+    CHECK(found == 0);
+}
+
+TEST_CASE("Merge join of z-levels", "[z_lvl_reader]") {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(dir);
+    // rows of [LINK_ID, POINT_NUM, Z_LEVEL] ordered by LINK_ID
+    std::vector<std::vector<int>> rows = { { 10, 1, 0 }, { 10, 2, 1 }, { 20, 1, 0 }, { 30, 1, -1 }, { 30, 2, 0 }, {
+            30, 3, -1 }, { 40, 1, 0 } };
+    DBFHandle handle = DBFCreate((dir / ZLEVELS_DBF).c_str());
+    REQUIRE(handle);
+    DBFAddField(handle, LINK_ID, FTInteger, 10, 0);
+    DBFAddField(handle, POINT_NUM, FTInteger, 5, 0);
+    DBFAddField(handle, Z_LEVEL, FTInteger, 2, 0);
+    for (int i = 0; i < rows.size(); i++)
+        for (int field = 0; field < 3; field++)
+            DBFWriteIntegerAttribute(handle, i, field, rows.at(i).at(field));
+    DBFClose(handle);
+
+    z_lvl_index z_level_map;
+    init_z_level_map(dir, cnull, z_level_map);
+    z_level_map.sort();
+    CHECK(z_level_map.size() == 2);
+
+    z_lvl_reader indexed(&z_level_map, dir);
+    z_lvl_reader streamed(nullptr, dir);
+    for (link_id_type link_id : { 5, 10, 10, 20, 25, 30, 40, 50 }) {
+        CAPTURE(link_id);
+        z_lvl_range index_range = indexed.find(link_id);
+        z_lvl_range stream_range = streamed.find(link_id);
+        CHECK(index_z_lvl_vector_type(index_range.begin(), index_range.end())
+                == index_z_lvl_vector_type(stream_range.begin(), stream_range.end()));
+    }
+    // workers start in the middle of Zlevels.dbf
+    z_lvl_reader worker(nullptr, dir);
+    z_lvl_range range = worker.find(30);
+    CHECK(index_z_lvl_vector_type(range.begin(), range.end()) == index_z_lvl_vector_type( { { 0, -1 }, { 2, -1 } }));
+
+    CHECK(dbf_ordered_by_link_id(dir / ZLEVELS_DBF));
+    boost::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Join restrictions of links", "[link_restrictions]") {
+    g_cdms_map.add(10, 1, CT_TRANSPORT_ACCESS_RESTRICTION);
+    g_cdms_map.add(10, 2, CT_TRANSPORT_ACCESS_RESTRICTION);
+    g_cdms_map.add(20, 2, CT_TRANSPORT_ACCESS_RESTRICTION);
+    g_cdms_map.add(30, 3, CT_TRANSPORT_ACCESS_RESTRICTION);
+    g_cdms_map.sort();
+    g_cnd_mod_rows.push_back(std::make_pair(2, mod_group_type(MT_HEIGHT_RESTRICTION, 350)));
+    g_cnd_mod_rows.push_back(std::make_pair(4, mod_group_type(MT_WIDTH_RESTRICTION, 200)));
+    g_cnd_mod_rows.push_back(std::make_pair(1, mod_group_type(MT_HEIGHT_RESTRICTION, 400)));
+    g_cnd_mod_rows.push_back(std::make_pair(2, mod_group_type(MT_WEIGHT_RESTRICTION, 7500)));
+    init_link_restrictions();
+
+    CHECK(g_cnd_mod_rows.empty());
+    CHECK(g_link_restrictions.size() == 2);
+    const link_restrictions_type* link = g_link_restrictions.find(10);
+    REQUIRE(link);
+    CHECK(link->has(link_restrictions_type::height));
+    CHECK(link->values[link_restrictions_type::height] == 350);
+    CHECK(link->has(link_restrictions_type::weight));
+    CHECK(link->values[link_restrictions_type::weight] == 7500);
+    CHECK(!link->has(link_restrictions_type::width));
+    REQUIRE(g_link_restrictions.find(20));
+    CHECK(g_link_restrictions.find(20)->values[link_restrictions_type::height] == 350);
+    CHECK(!g_link_restrictions.find(30));
+
+    g_cdms_map.clear();
+    g_link_restrictions.clear();
+}
+
+TEST_CASE("Merge directory pipelines", "[dir_pipelines]") {
+    osmium::Location a(1.0, 1.0), b(2.0, 1.0);
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path("comm2osm-test-%%%%-%%%%");
+    boost::filesystem::create_directory(dir);
+
+    // both directories end a way at a with z-level 0 and at b with different z-levels
+    clear_all();
+    for (size_t i = 0; i < 2; i++) {
+        g_osm_id = dir_pipeline_first_id(i, 2);
+        osmium::unsigned_object_id_type a_id = build_node(a);
+        osmium::unsigned_object_id_type b_id = build_node(b);
+        g_node_buffer.commit();
+        g_way_end_points_map.insert(a, a_id);
+        g_z_lvl_nodes_map.insert(b, i, b_id);
+        {
+            osmium::builder::WayBuilder builder(g_way_buffer);
+            static_cast<osmium::Way&>(builder.object()).set_id(g_osm_id++);
+            builder.add_user("test");
+            osmium::builder::WayNodeListBuilder wnl_builder(g_way_buffer, &builder);
+            wnl_builder.add_node_ref(a_id, a);
+            wnl_builder.add_node_ref(b_id, b);
+        }
+        g_way_buffer.commit();
+        write_dir_pipeline_result(dir_pipeline_files(dir / std::to_string(i)), dir_pipeline_first_id(i, 2),
+                collect_end_points());
+        clear_all();
+    }
+
+    z_lvl_nodes_map_type end_points;
+    for (size_t i = 0; i < 2; i++)
+        merge_dir_pipeline_result(dir_pipeline_files(dir / std::to_string(i)), end_points);
+
+    // the second node at a is replaced by the first one, ids are consecutive
+    osm_id_vector_type node_ids;
+    add_buffer_ids(node_ids, g_node_buffer);
+    CHECK(node_ids == osm_id_vector_type( { 1, 2, 5 }));
+    std::vector<osm_id_vector_type> way_node_ids;
+    for (auto it = g_way_buffer.begin<osmium::Way>(); it != g_way_buffer.end<osmium::Way>(); ++it) {
+        CHECK((it->id() == 3 || it->id() == 6));
+        way_node_ids.push_back(osm_id_vector_type());
+        for (auto& node_ref : it->nodes())
+            way_node_ids.back().push_back(node_ref.ref());
+    }
+    CHECK(way_node_ids == std::vector<osm_id_vector_type>( { { 1, 2 }, { 1, 5 } }));
+    CHECK(g_osm_id == 7);
+
+    clear_all();
+    boost::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Merge street worker results", "[street_workers]") {
+    osmium::Location a(0.0, 0.0);
+    std::vector<osmium::Location> b = { osmium::Location(1.0, 0.0), osmium::Location(0.0, 1.0) };
+
+    // end point a was created before the streets
+    clear_all();
+    osmium::unsigned_object_id_type a_id = build_node(a);
+    g_node_buffer.commit();
+    osmium::memory::Buffer end_point_buffer = std::move(g_node_buffer);
+
+    // two workers create a node and a way from a to the node for link 10 + i each
+    std::vector<street_worker_result_uptr> results;
+    for (size_t i = 0; i < 2; i++) {
+        g_osm_id = STREET_WORKER_FIRST_ID;
+        g_node_buffer = osmium::memory::Buffer(buffer_size);
+        g_way_buffer = osmium::memory::Buffer(buffer_size);
+        g_link_ways.clear();
+        osmium::unsigned_object_id_type b_id = build_node(b.at(i));
+        osmium::unsigned_object_id_type way_id = g_osm_id++;
+        {
+            osmium::builder::WayBuilder builder(g_way_buffer);
+            static_cast<osmium::Way&>(builder.object()).set_id(way_id);
+            builder.add_user("test");
+            osmium::builder::WayNodeListBuilder wnl_builder(g_way_buffer, &builder);
+            wnl_builder.add_node_ref(a_id, a);
+            wnl_builder.add_node_ref(b_id, b.at(i));
+        }
+        g_node_buffer.commit();
+        g_way_buffer.commit();
+        add_link_way(10 + i, way_id, osmium::NodeRef(a_id, a), osmium::NodeRef(b_id, b.at(i)));
+
+        results.push_back(street_worker_result_uptr(new street_worker_result()));
+        results.back()->sequence = i;
+        results.back()->node_buffer = std::move(g_node_buffer);
+        results.back()->way_buffer = std::move(g_way_buffer);
+        results.back()->link_ways = std::move(g_link_ways);
+        results.back()->end_osm_id = g_osm_id;
+    }
+
+    g_node_buffer = std::move(end_point_buffer);
+    g_way_buffer = osmium::memory::Buffer(buffer_size);
+    g_link_ways.clear();
+    g_osm_id = a_id + 1;
+    for (auto& result : results)
+        merge_street_worker_result(*result);
+
+    // worker ids are consecutive after a, references to a are kept
+    osm_id_vector_type node_ids;
+    add_buffer_ids(node_ids, g_node_buffer);
+    CHECK(node_ids == osm_id_vector_type( { 1, 2, 4 }));
+    osm_id_vector_type way_ids;
+    std::vector<osm_id_vector_type> way_node_ids;
+    for (auto it = g_way_buffer.begin<osmium::Way>(); it != g_way_buffer.end<osmium::Way>(); ++it) {
+        way_ids.push_back(it->id());
+        way_node_ids.push_back(osm_id_vector_type());
+        for (auto& node_ref : it->nodes())
+            way_node_ids.back().push_back(node_ref.ref());
+    }
+    CHECK(way_ids == osm_id_vector_type( { 3, 5 }));
+    CHECK(way_node_ids == std::vector<osm_id_vector_type>( { { 1, 2 }, { 1, 4 } }));
+    CHECK(g_osm_id == 6);
+
+    // link ways refer to the same ids as the ways
+    REQUIRE(g_link_ways.size() == 2);
+    for (size_t i = 0; i < 2; i++) {
+        CHECK(g_link_ways.at(i).link_id == 10 + i);
+        CHECK(g_link_ways.at(i).first_way_id == way_ids.at(i));
+        CHECK(g_link_ways.at(i).last_way_id == way_ids.at(i));
+        CHECK(g_link_ways.at(i).front.ref() == way_node_ids.at(i).front());
+        CHECK(g_link_ways.at(i).back.ref() == way_node_ids.at(i).back());
+        CHECK(g_link_ways.at(i).back.location() == b.at(i));
+    }
+
+    clear_all();
+}
+
+TEST_CASE("Merge admin worker results", "[admin_workers]") {
+    OGRLinearRing ring;
+    ring.addPoint(0, 0);
+    ring.addPoint(1, 0);
+    ring.addPoint(1, 1);
+    ring.addPoint(0, 0);
+
+    // two workers create a boundary of three nodes, one way and one relation each
+    clear_all();
+    std::vector<admin_worker_result_uptr> results;
+    for (size_t i = 0; i < 2; i++) {
+        g_osm_id = STREET_WORKER_FIRST_ID;
+        g_node_buffer = osmium::memory::Buffer(buffer_size);
+        g_way_buffer = osmium::memory::Buffer(buffer_size);
+        g_rel_buffer = osmium::memory::Buffer(buffer_size);
+        osm_id_vector_type way_ids = build_admin_boundary_ways(&ring);
+        {
+            osmium::builder::RelationBuilder builder(g_rel_buffer);
+            static_cast<osmium::Relation&>(builder.object()).set_id(g_osm_id++);
+            builder.add_user("test");
+            build_relation_members(builder, way_ids, osm_id_vector_type());
+        }
+        g_node_buffer.commit();
+        g_way_buffer.commit();
+        g_rel_buffer.commit();
+
+        results.push_back(admin_worker_result_uptr(new admin_worker_result()));
+        results.back()->node_buffer = std::move(g_node_buffer);
+        results.back()->way_buffer = std::move(g_way_buffer);
+        results.back()->rel_buffer = std::move(g_rel_buffer);
+        results.back()->end_osm_id = g_osm_id;
+    }
+
+    g_node_buffer = osmium::memory::Buffer(buffer_size);
+    g_way_buffer = osmium::memory::Buffer(buffer_size);
+    g_rel_buffer = osmium::memory::Buffer(buffer_size);
+    g_osm_id = 1;
+
+    for (auto& result : results)
+        merge_admin_worker_result(*result);
+
+    // ids are the same as if both boundaries had been created by one thread
+    osm_id_vector_type node_ids;
+    add_buffer_ids(node_ids, g_node_buffer);
+    CHECK(node_ids == osm_id_vector_type( { 1, 2, 3, 6, 7, 8 }));
+    std::vector<osm_id_vector_type> way_node_ids;
+    for (auto it = g_way_buffer.begin<osmium::Way>(); it != g_way_buffer.end<osmium::Way>(); ++it) {
+        CHECK((it->id() == 4 || it->id() == 9));
+        way_node_ids.push_back(osm_id_vector_type());
+        for (auto& node_ref : it->nodes())
+            way_node_ids.back().push_back(node_ref.ref());
+    }
+    CHECK(way_node_ids == std::vector<osm_id_vector_type>( { { 1, 2, 3, 1 }, { 6, 7, 8, 6 } }));
+    osm_id_vector_type member_ids;
+    for (auto it = g_rel_buffer.begin<osmium::Relation>(); it != g_rel_buffer.end<osmium::Relation>(); ++it) {
+        CHECK((it->id() == 5 || it->id() == 10));
+        for (auto& member : it->members())
+            member_ids.push_back(member.ref());
+    }
+    CHECK(member_ids == osm_id_vector_type( { 4, 9 }));
+    CHECK(g_osm_id == 11);
+
+    clear_all();
+}
+
+TEST_CASE("Shared borders of administrative boundaries", "[admin_topology]") {
+    // squares a and b share the border (1 0, 1 1), c is equal to a (e.g. on another admin level)
+    OGRLinearRing a, b;
+    a.addPoint(0, 0);
+    a.addPoint(1, 0);
+    a.addPoint(1, 1);
+    a.addPoint(0, 1);
+    a.addPoint(0, 0);
+    b.addPoint(1, 0);
+    b.addPoint(2, 0);
+    b.addPoint(2, 1);
+    b.addPoint(1, 1);
+    b.addPoint(1, 0);
+
+    clear_all();
+    admin_topology topology;
+    for (OGRLinearRing* ring : { &a, &b, &a }) {
+        topology.add_ring(ring, false);
+        topology.end_feature();
+    }
+    topology.find_junctions();
+    REQUIRE(topology.feature_count() == 3);
+
+    std::vector<osm_id_vector_type> way_ids;
+    for (size_t feature = 0; feature < topology.feature_count(); feature++) {
+        osm_id_vector_type exterior_way_ids, interior_way_ids;
+        topology.build_feature_ways(feature, exterior_way_ids, interior_way_ids);
+        CHECK(interior_way_ids.empty());
+        way_ids.push_back(exterior_way_ids);
+    }
+    g_node_buffer.commit();
+    g_way_buffer.commit();
+
+    // the shared border is way 3, a and c refer to the same ways
+    CHECK(way_ids == std::vector<osm_id_vector_type>( { { 3, 6 }, { 9, 3 }, { 3, 6 } }));
+    osm_id_vector_type node_ids;
+    add_buffer_ids(node_ids, g_node_buffer);
+    CHECK(node_ids == osm_id_vector_type( { 1, 2, 4, 5, 7, 8 }));
+    std::vector<osm_id_vector_type> way_node_ids;
+    for (auto it = g_way_buffer.begin<osmium::Way>(); it != g_way_buffer.end<osmium::Way>(); ++it) {
+        way_node_ids.push_back(osm_id_vector_type());
+        for (auto& node_ref : it->nodes())
+            way_node_ids.back().push_back(node_ref.ref());
+    }
+    CHECK(way_node_ids == std::vector<osm_id_vector_type>( { { 1, 2 }, { 1, 4, 5, 2 }, { 1, 7, 8, 2 } }));
+
+    clear_all();
+}
+
+TEST_CASE("Degenerate rings of administrative boundaries", "[admin_topology]") {
+    // a collapses to one point, b runs back and forth between two points
+    OGRLinearRing a, b, c;
+    a.addPoint(0, 0);
+    a.addPoint(0, 0);
+    a.addPoint(0, 0);
+    b.addPoint(0, 0);
+    b.addPoint(1, 0);
+    b.addPoint(1, 0);
+    b.addPoint(0, 0);
+    c.addPoint(0, 0);
+    c.addPoint(1, 0);
+    c.addPoint(1, 1);
+
+    clear_all();
+    admin_topology topology;
+    CHECK_THROWS_AS(topology.add_ring(&a, false), format_error);
+    CHECK_THROWS_AS(topology.add_ring(&b, true), format_error);
+    CHECK_THROWS_AS(topology.add_ring(&c, false), format_error);
+    topology.end_feature();
+    topology.find_junctions();
+
+    // rejected rings leave no ways behind
+    osm_id_vector_type exterior_way_ids, interior_way_ids;
+    topology.build_feature_ways(0, exterior_way_ids, interior_way_ids);
+    CHECK(exterior_way_ids.empty());
+    CHECK(interior_way_ids.empty());
+
+    clear_all();
+}
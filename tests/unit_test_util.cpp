@@ -1,7 +1,20 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <osmium/builder/osm_object_builder.hpp>
+
+#include "../plugins/bounded_queue.hpp"
+#include "../plugins/location_index.hpp"
+#include "../plugins/offset_curve.hpp"
+#include "../plugins/stats.hpp"
+#include "../plugins/task_graph.hpp"
 #include "../plugins/util.hpp"
+#include "../plugins/writers.hpp"
 
 TEST_CASE("Shapefile exists", "[SHP exist]"){
     CHECK(shp_file_exists("tests/testdata/faroe-islands-latest/roads.shp") == true);
@@ -175,3 +188,357 @@ TEST_CASE("ogr2wkb", "[ogr2wkb]"){
     CHECK(wkb_test == wkb_reference);
 }
 
+TEST_CASE("ogr2geos and geos2ogr", "[ogr2geos]"){
+    // the direct conversions have to produce the same geometries as the conversions via WKB
+    std::vector<std::string> wkts = { "LINESTRING (30 10, 10 30, 40 40)",
+            "POLYGON ((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 2 4, 4 4, 4 2, 2 2))" };
+    geometry_context ctx;
+    for (auto& wkt : wkts) {
+        OGRGeometry* ogr_geom;
+        char* wkt_c = const_cast<char*>(wkt.c_str());
+        OGRErr res = OGRGeometryFactory::createFromWkt(&wkt_c, nullptr, &ogr_geom);
+        REQUIRE(res == OGRERR_NONE);
+
+        std::unique_ptr<geos::geom::Geometry> geos_direct(ogr2geos(ctx, ogr_geom));
+        std::unique_ptr<geos::geom::Geometry> geos_wkb(wkb2geos(ctx, ogr2wkb(ogr_geom)));
+        CHECK(geos2wkb(ctx, geos_direct.get()) == geos2wkb(ctx, geos_wkb.get()));
+
+        std::unique_ptr<OGRGeometry> ogr_direct(geos2ogr(ctx, geos_direct.get()));
+        std::unique_ptr<OGRGeometry> ogr_wkb(wkb2ogr(geos2wkb(ctx, geos_direct.get())));
+        CHECK(ogr_direct->getGeometryType() == ogr_geom->getGeometryType());
+        CHECK(ogr2wkb(ogr_direct.get()) == ogr2wkb(ogr_wkb.get()));
+        CHECK(ogr2wkb(ogr_direct.get()) == ogr2wkb(ogr_geom));
+        delete ogr_geom;
+    }
+}
+
+
+TEST_CASE("offset_curve_builder", "[offset_curve]"){
+    // zigzag, sharp and collinear turns, a reversal, a repeated vertex and a closed line
+    std::vector<std::vector<double>> lines = {
+            { 10.000, 10.000, 10.001, 10.001, 10.002, 10.000, 10.003, 10.001, 10.004, 10.000 },
+            { 0.0, 0.0, 0.001, 0.0, 0.002, 0.0, 0.002, 0.001 },
+            { 0.0, 0.0, 0.001, 0.0, 0.0, 0.00001, 0.001, 0.00002 },
+            { 5.0, 5.0, 5.002, 5.0, 5.001, 5.0 },
+            { 5.0, 5.0, 5.001, 5.0, 5.001, 5.0, 5.001, 5.001 },
+            { 7.0, 7.0, 7.001, 7.0, 7.001, 7.001, 7.0, 7.001, 7.0, 7.0 } };
+    geometry_context ctx;
+    offset_curve_builder builder;
+    std::vector<double> offset_xy;
+    for (auto& xy : lines) {
+        OGRLineString ogr_ls;
+        for (size_t i = 0; i < xy.size(); i += 2)
+            ogr_ls.addPoint(xy.at(i), xy.at(i + 1));
+        for (bool left : { true, false }) {
+            CAPTURE(ogr_ls.getNumPoints());
+            CAPTURE(left);
+            std::unique_ptr<OGRLineString> reference(create_offset_curve(ctx, &ogr_ls, 0.00005, left));
+            builder.build(polyline_span(xy.data(), xy.size() / 2), 0.00005, left, offset_xy);
+            REQUIRE(offset_xy.size() == 2 * reference->getNumPoints());
+            for (int i = 0; i < reference->getNumPoints(); i++) {
+                CHECK(offset_xy.at(2 * i) == Approx(reference->getX(i)).epsilon(1e-9));
+                CHECK(offset_xy.at(2 * i + 1) == Approx(reference->getY(i)).epsilon(1e-9));
+            }
+        }
+    }
+
+    // the offset curve of a very short line collapses to a single vertex, its caps can't be cut
+    std::vector<double> short_line = { 3.0, 3.0, 3.0 + 1e-12, 3.0 };
+    for (bool left : { true, false }) {
+        builder.build(polyline_span(short_line.data(), 2), 0.00005, left, offset_xy);
+        CHECK(offset_xy.size() == 2);
+    }
+}
+
+TEST_CASE("mmap_dbf_reader", "[mmap_dbf_reader]"){
+    const char* dbf_file = "tests/testdata/faroe-islands-latest/roads.dbf";
+    mmap_dbf_reader dbf(dbf_file, cnull);
+    DBFHandle handle = DBFOpen(dbf_file, "rb");
+    REQUIRE(handle);
+
+    CHECK(dbf.record_count() == DBFGetRecordCount(handle));
+    CHECK(dbf.field_index("osm_id") == DBFGetFieldIndex(handle, "osm_id"));
+    CHECK(dbf.field_index("MAXSPEED") == DBFGetFieldIndex(handle, "maxspeed"));
+    CHECK(dbf.field_index("missing") == -1);
+
+    int name = dbf.field_index("name");
+    int maxspeed = dbf.field_index("maxspeed");
+    for (int i = 0; i < dbf.record_count(); i++) {
+        CHECK(dbf.get_string(i, name) == std::string(DBFReadStringAttribute(handle, i, name)));
+        CHECK(dbf.get_int(i, maxspeed) == DBFReadIntegerAttribute(handle, i, maxspeed));
+        CHECK(dbf_get_uint_by_field(dbf, i, "osm_id") == dbf_get_uint_by_field(handle, i, "osm_id"));
+    }
+    DBFClose(handle);
+}
+
+TEST_CASE("shp_polyline_reader", "[shp_polyline_reader]"){
+    const char* shp_file = "tests/testdata/faroe-islands-latest/roads.shp";
+    shp_polyline_reader shp(shp_file);
+    ogr_layer_uptr layer(read_shape_file(shp_file, cnull));
+
+    CHECK(shp.record_count() == layer->GetFeatureCount());
+
+    ogr_feature_cursor cursor(layer.get());
+    while (cursor.next()) {
+        auto& feat = cursor.feature();
+        OGRLineString* ogr_ls = static_cast<OGRLineString*>(feat->GetGeometryRef());
+        polyline_span line = shp.read(feat->GetFID());
+        REQUIRE(line.size() == ogr_ls->getNumPoints());
+        for (int i = 0; i < ogr_ls->getNumPoints(); i++) {
+            CHECK(line.x(i) == ogr_ls->getX(i));
+            CHECK(line.y(i) == ogr_ls->getY(i));
+        }
+        polyline_span tail = line.sub(1, line.size() - 1);
+        CHECK(tail.size() == line.size() - 1);
+        CHECK(tail.location(0) == line.location(1));
+    }
+
+    CHECK_THROWS(shp.read(shp.record_count()));
+}
+
+TEST_CASE("buffer_spool", "[buffer_spool]"){
+    osmium::memory::Buffer buffer(1024);
+    buffer_spool spool;
+    for (osmium::object_id_type id = 1; id <= 3; id++) {
+        {
+            osmium::builder::NodeBuilder builder(buffer);
+            static_cast<osmium::Node&>(builder.object()).set_id(id);
+            builder.add_user("test");
+        }
+        buffer.commit();
+        spool.write(buffer);
+        CHECK(buffer.committed() == 0);
+    }
+
+    std::vector<osmium::object_id_type> ids;
+    spool.replay([&ids](osmium::memory::Buffer&& chunk) {
+        for (auto it = chunk.begin<osmium::Node>(); it != chunk.end<osmium::Node>(); ++it)
+            ids.push_back(it->id());
+    });
+    CHECK(ids == std::vector<osmium::object_id_type>({1, 2, 3}));
+
+    // replay empties the spool
+    ids.clear();
+    spool.replay([&ids](osmium::memory::Buffer&& chunk) {ids.push_back(0);});
+    CHECK(ids.empty());
+}
+
+TEST_CASE("location_id_index", "[location_id_index]"){
+    location_id_index index;
+    CHECK(index.empty());
+    CHECK(index.find(osmium::Location(1.0, 2.0)) == nullptr);
+    CHECK_THROWS_AS(index.at(osmium::Location(1.0, 2.0)), std::out_of_range);
+
+    CHECK(index.insert(osmium::Location(1.0, 2.0), 17));
+    CHECK_FALSE(index.insert(osmium::Location(1.0, 2.0), 18));
+    CHECK(index.at(osmium::Location(1.0, 2.0)) == 17);
+    CHECK(index.find(osmium::Location(2.0, 1.0)) == nullptr);
+
+    // neighbouring coordinates and growth beyond the initial capacity
+    std::map<osmium::Location, osmium::unsigned_object_id_type> reference;
+    for (int x = -100; x < 100; x++)
+        for (int y = -50; y < 50; y++)
+            reference.insert(std::make_pair(osmium::Location(x, y), reference.size() + 100));
+    for (auto& it : reference)
+        index.insert(it.first, it.second);
+    CHECK(index.size() == reference.size() + 1);
+    for (auto& it : reference)
+        CHECK(index.at(it.first) == it.second);
+
+    std::map<osmium::Location, osmium::unsigned_object_id_type> entries;
+    index.for_each([&entries](const osmium::Location& location, osmium::unsigned_object_id_type id) {
+        entries.insert(std::make_pair(location, id));
+    });
+    reference.insert(std::make_pair(osmium::Location(1.0, 2.0), 17));
+    CHECK(entries == reference);
+
+    index.clear();
+    CHECK(index.empty());
+    CHECK(index.find(osmium::Location(1.0, 2.0)) == nullptr);
+}
+
+TEST_CASE("location_id_index with mmap backend", "[location_id_index]"){
+    location_id_index index;
+    for (int x = 0; x < 1000; x++)
+        index.insert(osmium::Location(x, -x), x);
+
+    // entries survive moving the table into a file
+    index.set_backend(location_index_backend::mmap, boost::filesystem::temp_directory_path());
+    CHECK(index.size() == 1000);
+    for (int x = 1000; x < 5000; x++)
+        index.insert(osmium::Location(x, -x), x);
+    for (int x = 0; x < 5000; x++)
+        CHECK(index.at(osmium::Location(x, -x)) == x);
+
+    CHECK_THROWS_AS(index.set_backend(location_index_backend::mmap, "/nonexistent/directory"), osmium::io_error);
+}
+
+TEST_CASE("location_level_id_index", "[location_id_index]"){
+    location_level_id_index index;
+    CHECK(index.find(osmium::Location(1.0, 2.0), 1) == nullptr);
+
+    CHECK(index.insert(osmium::Location(1.0, 2.0), 1, 17));
+    CHECK(index.insert(osmium::Location(1.0, 2.0), -2, 18));
+    CHECK_FALSE(index.insert(osmium::Location(1.0, 2.0), 1, 19));
+    CHECK(index.size() == 2);
+    CHECK(index.at(osmium::Location(1.0, 2.0), 1) == 17);
+    CHECK(index.at(osmium::Location(1.0, 2.0), -2) == 18);
+    CHECK(index.find(osmium::Location(1.0, 2.0), 0) == nullptr);
+    CHECK_THROWS_AS(index.at(osmium::Location(1.0, 2.0), 3), std::out_of_range);
+
+    index.set_backend(location_index_backend::mmap, boost::filesystem::temp_directory_path());
+    CHECK(index.insert(osmium::Location(3.0, 4.0), 5, 20));
+    CHECK(index.at(osmium::Location(1.0, 2.0), 1) == 17);
+    CHECK(index.at(osmium::Location(3.0, 4.0), 5) == 20);
+
+    index.clear();
+    CHECK(index.size() == 0);
+}
+
+TEST_CASE("conversion_stats", "[conversion_stats]"){
+    conversion_stats stats;
+    stats.begin("first", 10);
+    stats.add_rows(5);
+    stats.add_rows(7);
+    stats.end(15);
+    stats.begin("second \"quoted\"", 15);
+    // e.g. objects of child processes
+    stats.add_objects(4);
+    stats.end(16);
+    // rows outside of phases are ignored
+    stats.add_rows(3);
+
+    REQUIRE(stats.get_phases().size() == 2);
+    auto& first = stats.get_phases().at(0);
+    CHECK(first.name == "first");
+    CHECK(first.rows == 12);
+    CHECK(first.objects == 5);
+    CHECK(first.wall_seconds >= 0);
+    CHECK(first.max_rss_kb > 0);
+    CHECK(stats.get_phases().at(1).rows == 0);
+    CHECK(stats.get_phases().at(1).objects == 5);
+
+    std::ostringstream json;
+    stats.write(json, stats_format::json);
+    CHECK(json.str().find("{\"phases\":[{\"name\":\"first\",") == 0);
+    CHECK(json.str().find("\"name\":\"second \\\"quoted\\\"\"") != std::string::npos);
+}
+
+TEST_CASE("bounded_queue", "[bounded_queue]"){
+    bounded_queue<std::unique_ptr<int>> queue(3);
+    CHECK(queue.capacity() == 4);
+    for (int i = 0; i < 4; i++) {
+        std::unique_ptr<int> value(new int(i));
+        CHECK(queue.try_push(value));
+        CHECK(!value);
+    }
+    std::unique_ptr<int> value(new int(4));
+    CHECK_FALSE(queue.try_push(value));
+    CHECK(*value == 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(queue.try_pop(value));
+        CHECK(*value == i);
+    }
+    CHECK_FALSE(queue.try_pop(value));
+
+    // every element is popped exactly once by concurrent producers and consumers
+    bounded_queue<int> numbers(16);
+    const int count = 100000;
+    std::atomic<long long> sum(0);
+    std::atomic<int> popped(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 2; p++)
+        threads.push_back(std::thread([&numbers, p] {
+            for (int i = p; i < count; i += 2)
+                while (!numbers.try_push(i))
+                    std::this_thread::yield();
+        }));
+    for (int c = 0; c < 2; c++)
+        threads.push_back(std::thread([&numbers, &sum, &popped] {
+            int number;
+            while (popped < count) {
+                if (numbers.try_pop(number)) {
+                    sum += number;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(sum == (long long) count * (count - 1) / 2);
+}
+
+TEST_CASE("task_graph", "[task_graph]"){
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&mutex, &order](const std::string& name) {
+        return [&mutex, &order, name] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+        };
+    };
+
+    // a and b are independent, c combines them, d depends on c
+    task_graph graph;
+    auto a = graph.add("a", record("a"));
+    auto b = graph.add("b", record("b"));
+    auto c = graph.add("c", record("c"), { a, b });
+    graph.add("d", record("d"), { c });
+    graph.run(3);
+    REQUIRE(order.size() == 4);
+    CHECK(order.at(2) == "c");
+    CHECK(order.at(3) == "d");
+    for (auto& t : graph.get_tasks())
+        CHECK(t.end_seconds >= t.start_seconds);
+    std::ostringstream timing;
+    graph.write_timing(timing);
+    CHECK(timing.str().find("  d ") != std::string::npos);
+
+    // dependents of a failed task aren't run, the exception is rethrown
+    task_graph failing;
+    bool dependent_run = false;
+    auto failed = failing.add("failed", [] {throw std::runtime_error("task failed");});
+    failing.add("dependent", [&dependent_run] {dependent_run = true;}, { failed });
+    CHECK_THROWS_AS(failing.run(2), std::runtime_error);
+    CHECK_FALSE(dependent_run);
+}
+
+TEST_CASE("pipeline_monitor", "[bounded_queue]"){
+    // a consumer sleeps until the producer has pushed all numbers
+    pipeline_monitor monitor;
+    bounded_queue<int> numbers(2);
+    const int count = 1000;
+    long long sum = 0;
+    // assertions aren't thread safe, results of other threads are checked after joining
+    bool popped = true;
+    std::thread consumer([&monitor, &numbers, &sum, &popped] {
+        int number;
+        for (int i = 0; i < count && popped; i++) {
+            popped = monitor.pop(numbers, number);
+            sum += number;
+        }
+    });
+    bool pushed = true;
+    for (int i = 0; i < count && pushed; i++) {
+        int number = i;
+        pushed = monitor.push(numbers, number);
+    }
+    consumer.join();
+    CHECK(pushed);
+    CHECK(popped);
+    CHECK(sum == (long long) count * (count - 1) / 2);
+
+    // abort() wakes a waiting stage
+    bool waited = true;
+    std::thread waiting([&monitor, &waited] {
+        waited = monitor.wait([] {return false;});
+    });
+    monitor.abort();
+    waiting.join();
+    CHECK_FALSE(waited);
+    CHECK(monitor.aborted());
+    int number = 0;
+    CHECK_FALSE(monitor.pop(numbers, number));
+}